@@ -8,6 +8,15 @@
 #include <charconv>
 #include <functional>
 #include <system_error>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+
+#include "enum-names.hh"
+#include "validator.hh"
+#include "pattern.hh"
+#include "flat-map.hh"
+#include "writer.hh"
 
 #ifdef CARP_DEBUG
 namespace tests
@@ -25,20 +34,140 @@ namespace carp
         StoreMany,
         SetTrue,
         SetFalse,
-        Count
+        Count,
+        StoreMap
+    };
+
+    //Which value a `StoreMap` argument keeps when the same key is given more than once
+    enum class MapPolicy
+    {
+        LastWins,
+        FirstWins
+    };
+
+    /*
+        Customization point for `CmdArg::try_parse<T>()`: specialize it for a type with a static member function
+        `std::optional<T> convert(const std::vector<std::string>& values, Args...)`, e.g.
+
+            template <>
+            struct carp::converter<Endpoint>
+            {
+                static std::optional<Endpoint> convert(const std::vector<std::string>& values) noexcept;
+            };
+
+        The converter is found and inlined at compile time, T needs no default constructor, and `try_parse<T>()`
+        is noexcept whenever `convert` is. Any arguments after the first are those passed to `try_parse<T>(...)`.
+    */
+    template <typename T>
+    struct converter;
+
+    namespace detail
+    {
+        template <typename Void, typename T, typename ...Args>
+        struct has_converter : std::false_type {};
+
+        template <typename T, typename ...Args>
+        struct has_converter<std::void_t<decltype(converter<T>::convert(std::declval<const std::vector<std::string>&>(), std::declval<Args>()...))>, T, Args...> : std::true_type {};
+
+        template <typename Void, typename T, typename ...Args>
+        struct has_nothrow_converter : std::false_type {};
+
+        template <typename T, typename ...Args>
+        struct has_nothrow_converter<std::enable_if_t<has_converter<void, T, Args...>::value>, T, Args...>
+            : std::bool_constant<noexcept(converter<T>::convert(std::declval<const std::vector<std::string>&>(), std::declval<Args>()...))> {};
+
+        //A std::string rvalue: a view of one dangles at the end of the full expression, see the deleted `CmdArg` overloads
+        template <typename S>
+        using if_temporary_string = std::enable_if_t<std::is_same_v<S, std::string>>;
+
+        //The default of an argument; copies of the argument share it, so it is computed at most once for all of them
+        struct LazyDefault
+        {
+            std::function<std::string()> compute;
+            std::string_view description;           //shown by `--help` instead of the value, which may not exist yet
+            std::once_flag computed;
+            std::vector<std::string> values;
+        };
+    }
+
+    /*
+        Plain description of an argument for registering many of them at once with `Parser::add_arguments`.
+        An empty name or abbreviation defaults to the identifier, as with `CmdArg`.
+    */
+    struct CmdArgSpec
+    {
+        std::string_view identifier;
+        std::string_view name = {};
+        std::string_view abbreviation = {};
+        std::string_view help = {};
+        bool required = false;
+        ArgAction action = ArgAction::SetTrue;
     };
 
+    /*
+        A CmdArg stores its identifier, names and help text as views, so defining one never allocates;
+        the strings passed to it must outlive the argument (string literals always do). Passing a
+        std::string temporary, e.g. `CmdArg("plugin-" + std::to_string(i))`, is a compile error rather
+        than a dangling view: build such names into storage that lives as long as the parser. Long and short
+        names are stored without their "--" and "-" prefixes, which the parser strips off at match time.
+        Every builder has an rvalue overload, so a chain on a temporary `CmdArg("foo")...build()` moves
+        the definition into its shared_ptr instead of copying it.
+    */
     class CmdArg
     {
         public:
-            CmdArg(std::string);
-
-            CmdArg& name(std::string);
-            CmdArg& abbreviation(std::string);
-            CmdArg& help(std::string);
-            CmdArg& required(bool);
-            CmdArg& action(ArgAction);
-            std::shared_ptr<CmdArg> build();
+            CmdArg(std::string_view);
+
+            template <typename S, typename = detail::if_temporary_string<S>>
+            CmdArg(S&&) = delete;
+
+            CmdArg& name(std::string_view) &;
+            CmdArg&& name(std::string_view) &&;
+            CmdArg& abbreviation(std::string_view) &;
+            CmdArg&& abbreviation(std::string_view) &&;
+            CmdArg& help(std::string_view) &;
+            CmdArg&& help(std::string_view) &&;
+
+            template <typename S, typename = detail::if_temporary_string<S>>
+            void name(S&&) = delete;
+
+            template <typename S, typename = detail::if_temporary_string<S>>
+            void abbreviation(S&&) = delete;
+
+            template <typename S, typename = detail::if_temporary_string<S>>
+            void help(S&&) = delete;
+
+            CmdArg& required(bool) &;
+            CmdArg&& required(bool) &&;
+            CmdArg& action(ArgAction) &;
+            CmdArg&& action(ArgAction) &&;
+            CmdArg& map_policy(MapPolicy) &;
+            CmdArg&& map_policy(MapPolicy) &&;
+            CmdArg& validator(std::function<bool(std::string_view)>, bool) &;
+            CmdArg&& validator(std::function<bool(std::string_view)>, bool) &&;
+            CmdArg& validator(std::shared_ptr<Validator>) &;
+            CmdArg&& validator(std::shared_ptr<Validator>) &&;
+            CmdArg& pattern(std::string_view) &;
+            CmdArg&& pattern(std::string_view) &&;
+            CmdArg& default_value(std::string_view) &;
+            CmdArg&& default_value(std::string_view) &&;
+
+            template <typename S, typename = detail::if_temporary_string<S>>
+            void default_value(S&&) = delete;
+
+            CmdArg& default_value(std::function<std::string()>, std::string_view) &;
+            CmdArg&& default_value(std::function<std::string()>, std::string_view) &&;
+
+            template <typename E,
+            typename = std::enable_if_t<std::is_enum_v<E>>>
+            CmdArg& choices() &;
+
+            template <typename E,
+            typename = std::enable_if_t<std::is_enum_v<E>>>
+            CmdArg&& choices() &&;
+
+            std::shared_ptr<CmdArg> build() &;
+            std::shared_ptr<CmdArg> build() &&;
 
             template <typename T,
             typename = std::enable_if_t<std::is_integral_v<T>>>
@@ -50,11 +179,23 @@ namespace carp
 
             std::optional<bool> try_parse_bool() const;
 
+            template <typename E,
+            typename = std::enable_if_t<std::is_enum_v<E>>>
+            std::optional<E> try_parse_enum(bool ignore_case = false) const;
+
+            template <typename T, typename ...Args>
+            std::optional<T> try_parse(Args&&...) const noexcept(detail::has_nothrow_converter<void, T, Args...>::value);
+
             template <typename R, typename ...Args>
             std::optional<R> try_parse_user_defined(const std::function<bool(const std::vector<std::string>&,R&)>&, Args&&...) const;
 
+            std::optional<std::string_view> get_map_value(std::string_view) const;
+
             bool is_set() const;
+            std::string_view get_identifier() const;
+            std::string_view get_name() const;
             std::string summary() const;
+            void summary(Writer&) const;
 
             friend class Parser;
 
@@ -64,71 +205,210 @@ namespace carp
             #endif
 
         private:
-            std::string identifier;
-            std::string long_name;
-            std::string short_name;
-            std::string description;
+            std::string_view identifier;
+            std::string_view long_name;
+            std::string_view short_name;
+            std::string_view description;
             bool enforced;
             bool set;
 
             ArgAction on_parse;
             std::vector<std::string> values;
             unsigned int count;
+
+            FlatMap entries;
+            MapPolicy duplicate_keys;
+
+            const std::string_view* choice_names;
+            std::size_t choice_count;
+
+            std::vector<std::shared_ptr<Validator>> validators;
+            std::shared_ptr<const Pattern> value_pattern;
+            std::shared_ptr<detail::LazyDefault> lazy_default;
+
+            const std::vector<std::string>& current_values() const;
     };
 
-    CmdArg::CmdArg(std::string id = "")
+    CmdArg::CmdArg(std::string_view id = "")
     {
         identifier = id;
-        long_name = "--" + id;
-        short_name = "-" + id;
+        long_name = id;
+        short_name = id;
         enforced = false;
         set = false;
         on_parse = ArgAction::SetTrue;
-        values = std::vector<std::string>(1);
         count = 0;
+        duplicate_keys = MapPolicy::LastWins;
+        choice_names = nullptr;
+        choice_count = 0;
     }
 
-    CmdArg& CmdArg::name(std::string name)
+    CmdArg& CmdArg::name(std::string_view name) &
     {
-        long_name = "--" + name;
+        long_name = name;
         return *this;
     }
+
+    CmdArg&& CmdArg::name(std::string_view name) &&
+    {
+        return std::move(this->name(name));
+    }
     
-    CmdArg& CmdArg::abbreviation(std::string abbreviation)
+    CmdArg& CmdArg::abbreviation(std::string_view abbreviation) &
     {
-        short_name = "-" + abbreviation;
+        short_name = abbreviation;
         return *this;
     }
 
-    CmdArg& CmdArg::help(std::string help)
+    CmdArg&& CmdArg::abbreviation(std::string_view abbreviation) &&
+    {
+        return std::move(this->abbreviation(abbreviation));
+    }
+
+    CmdArg& CmdArg::help(std::string_view help) &
     {
         description = help;
         return *this;
     }
 
-    CmdArg& CmdArg::required(bool required)
+    CmdArg&& CmdArg::help(std::string_view help) &&
+    {
+        return std::move(this->help(help));
+    }
+
+    CmdArg& CmdArg::required(bool required) &
     {
         enforced = required;
         return *this;
     }
 
-    CmdArg& CmdArg::action(ArgAction action)
+    CmdArg&& CmdArg::required(bool required) &&
+    {
+        return std::move(this->required(required));
+    }
+
+    CmdArg& CmdArg::action(ArgAction action) &
     {
         on_parse = action;
         return *this;
     }
 
-    std::shared_ptr<CmdArg> CmdArg::build()
+    CmdArg&& CmdArg::action(ArgAction action) &&
+    {
+        return std::move(this->action(action));
+    }
+
+    CmdArg& CmdArg::map_policy(MapPolicy policy) &
+    {
+        duplicate_keys = policy;
+        return *this;
+    }
+
+    CmdArg&& CmdArg::map_policy(MapPolicy policy) &&
+    {
+        return std::move(this->map_policy(policy));
+    }
+
+    //Adds a check that every value of this argument must pass; `pure` checks are cached per value (see validator.hh)
+    CmdArg& CmdArg::validator(std::function<bool(std::string_view)> check, bool pure = true) &
+    {
+        validators.push_back(std::make_shared<Validator>(std::move(check), pure));
+        return *this;
+    }
+
+    CmdArg&& CmdArg::validator(std::function<bool(std::string_view)> check, bool pure = true) &&
+    {
+        return std::move(this->validator(std::move(check), pure));
+    }
+
+    //Shares one validator, and therefore one cache, between several arguments
+    CmdArg& CmdArg::validator(std::shared_ptr<Validator> check) &
+    {
+        validators.push_back(std::move(check));
+        return *this;
+    }
+
+    CmdArg&& CmdArg::validator(std::shared_ptr<Validator> check) &&
+    {
+        return std::move(this->validator(std::move(check)));
+    }
+
+    //Requires every value to match `source` as a whole (see pattern.hh); compiled right away, so a bad pattern throws here
+    CmdArg& CmdArg::pattern(std::string_view source) &
+    {
+        value_pattern = std::make_shared<const Pattern>(source);
+        return *this;
+    }
+
+    CmdArg&& CmdArg::pattern(std::string_view source) &&
+    {
+        return std::move(this->pattern(source));
+    }
+
+    //A constant default, used by the `try_parse_*` functions when the argument is not given; the string must outlive the argument
+    CmdArg& CmdArg::default_value(std::string_view value) &
+    {
+        return default_value([value]() { return std::string(value); }, value);
+    }
+
+    CmdArg&& CmdArg::default_value(std::string_view value) &&
+    {
+        return std::move(this->default_value(value));
+    }
+
+    /*
+        A default that is expensive to find out, e.g. from std::thread::hardware_concurrency() or /proc/meminfo:
+        `compute` only runs the first time the value of the argument is read while it is not set, and its result is
+        kept from then on (if it throws, the exception reaches the reader and the next read tries again). It runs
+        exactly once even when several threads read the argument at the same time. The help screen shows `description`.
+    */
+    CmdArg& CmdArg::default_value(std::function<std::string()> compute, std::string_view description = "") &
+    {
+        lazy_default = std::make_shared<detail::LazyDefault>();
+        lazy_default->compute = std::move(compute);
+        lazy_default->description = description;
+        return *this;
+    }
+
+    CmdArg&& CmdArg::default_value(std::function<std::string()> compute, std::string_view description = "") &&
+    {
+        return std::move(this->default_value(std::move(compute), description));
+    }
+
+    //Records the names in `carp::enum_names<E>` so that `summary()` can list them as the allowed values
+    template <typename E, typename>
+    CmdArg& CmdArg::choices() &
+    {
+        choice_names = detail::EnumTable<E>::names.data();
+        choice_count = detail::EnumTable<E>::names.size();
+        return *this;
+    }
+
+    template <typename E, typename>
+    CmdArg&& CmdArg::choices() &&
+    {
+        return std::move(this->choices<E>());
+    }
+
+    std::shared_ptr<CmdArg> CmdArg::build() &
     {
         return std::make_shared<CmdArg>(*this);
     }
 
-    template <typename T,
-    typename = std::enable_if_t<std::is_integral_v<T>>>
+    std::shared_ptr<CmdArg> CmdArg::build() &&
+    {
+        return std::make_shared<CmdArg>(std::move(*this));
+    }
+
+    template <typename T, typename>
     std::optional<T> CmdArg::try_parse_integer(int radix) const
     {
+        const std::vector<std::string>& given = current_values();
+        if (given.empty())
+            return std::nullopt;
+
         T value;
-        std::from_chars_result parse_result = std::from_chars(values[0].data(), values[0].data() + values[0].size(), /*out*/ value, radix);
+        std::from_chars_result parse_result = std::from_chars(given[0].data(), given[0].data() + given[0].size(), /*out*/ value, radix);
 
         if (parse_result.ec == std::errc{})
             return value;
@@ -145,25 +425,29 @@ namespace carp
 
         Original paper: https://www.open-std.org/jtc1/sc22/wg21/docs/papers/2016/p0067r5.html
     */
-    template <typename T, typename = std::enable_if_t<std::is_floating_point_v<T>>>
+    template <typename T, typename>
     std::optional<T> CmdArg::try_parse_floating_point() const
     {
         //As defined by the standard, std::is_floating_point<T>::value only returns true for
         //float, double, and long double
 
+        const std::vector<std::string>& given = current_values();
+        if (given.empty())
+            return std::nullopt;
+
         try
         {
             if constexpr (std::is_same_v<T, float>)
             {
-                return stof(values[0]);
+                return stof(given[0]);
             }
             else if (std::is_same_v<T, double>)
             {
-                return stod(values[0]);
+                return stod(given[0]);
             }
             else
             {
-                return stold(values[0]);
+                return stold(given[0]);
             }
         }
         catch(...)
@@ -174,32 +458,63 @@ namespace carp
 
     std::optional<bool> CmdArg::try_parse_bool() const
     {
-        //Algorithm from https://learning.oreilly.com/library/view/c-cookbook/0596007612/ch04s14.html#cplusplusckbk-CHP-4-SECT-13.3
-        const static auto case_insensitive_char_comp = [](unsigned char a, unsigned char b) -> bool {return tolower(a) == tolower(b);};
-        const static auto case_insensitive_str_comp = [](std::string_view a, std::string_view b) -> bool 
-        {
-            return a.length() == b.length() and std::equal(a.begin(), a.end(), b.begin(), case_insensitive_char_comp);
-        };
+        const std::vector<std::string>& given = current_values();
+        if (given.empty())
+            return std::nullopt;
 
-        if (case_insensitive_str_comp(values[0], "true"))
+        if (detail::iequals(given[0], "true"))
             return true;
 
-        if (case_insensitive_str_comp(values[0], "false"))
+        if (detail::iequals(given[0], "false"))
             return false;
 
         return std::nullopt;
     }
 
+    /*
+        Maps the argument's value to an enumerator of E using the compile-time perfect hash built from
+        `carp::enum_names<E>` (see enum-names.hh). With `ignore_case`, "ZSTD" matches "zstd" the same
+        way `try_parse_bool` accepts "TRUE".
+    */
+    template <typename E, typename>
+    std::optional<E> CmdArg::try_parse_enum(bool ignore_case) const
+    {
+        const std::vector<std::string>& given = current_values();
+        if (given.empty())
+            return std::nullopt;
+
+        return detail::EnumTable<E>::find(given[0], ignore_case);
+    }
+
+    /*
+        Converts the argument's values with `carp::converter<T>` (see above), passing along `args`. Nothing is caught:
+        exceptions from the converter reach the caller. When the default is computed on this call (see `default_value`)
+        and its callable throws, a noexcept `try_parse` terminates.
+    */
+    template <typename T, typename ...Args>
+    std::optional<T> CmdArg::try_parse(Args&&... args) const noexcept(detail::has_nothrow_converter<void, T, Args...>::value)
+    {
+        static_assert(detail::has_converter<void, T, Args...>::value, "[CARP] Error: try_parse<T>() needs a specialization of carp::converter<T> with a static 'std::optional<T> convert(const std::vector<std::string>&, ...)' accepting the given arguments!");
+
+        const std::vector<std::string>& given = current_values();
+        if (given.empty())
+            return std::nullopt;
+
+        return converter<T>::convert(given, std::forward<Args>(args)...);
+    }
+
     /*
         This callback function allows users to parse a CmdArg's values as any struct, class, enum, etc using 
         their own function. The function provided must be of the same format as std::from_chars, i.e.:
         1. The function must return bool (true if parsing succeeded, false is failed)
         2. The first parameter should be of type `const std::vector<std::string>&`, which will give the parsing function
-            the user passes in access to the CmdArg's `values` member
+            the user passes in access to the CmdArg's `values` member (or to its default, if it was not given)
         3. The second parameter to the function must be an output parameter, which will contain the parsed value
            if the parsing succeeds. Accessing the output parameter when parsing fails is undefined behavior.
 
         IMP: return type deduction often fails; always explicitly specify the return type with `try_parse_user_defined<foo>`
+        For converters on hot paths, prefer `try_parse<T>()` with a `carp::converter<T>` specialization, which avoids the
+        std::function, the default-constructed R, and the catch-all.
 
         C++ out parameters (subsection 'Out-parameters'): http://www.cs.ecu.edu/karl/2530/spr18/Notes/lec21A.html#:~:text=An%20out%2Dparameter%20represents%20information,parameters%20and%20two%20out%2Dparameters.
     */
@@ -210,7 +525,7 @@ namespace carp
         try
         {
             R parsed_value;
-            if (parser_func(values, /*out*/ parsed_value, std::forward<Args>(args)...))
+            if (parser_func(current_values(), /*out*/ parsed_value, std::forward<Args>(args)...))
                 return parsed_value;
         }
         catch (...)
@@ -221,15 +536,70 @@ namespace carp
         return std::nullopt;
     }
 
+    //The value given for `key` by a `StoreMap` argument, e.g. "value" for "-D key=value"
+    std::optional<std::string_view> CmdArg::get_map_value(std::string_view key) const
+    {
+        return entries.find(key);
+    }
+
     bool CmdArg::is_set() const
     {
         return set;
     }
 
+    std::string_view CmdArg::get_identifier() const
+    {
+        return identifier;
+    }
+
+    //The long name, without the "--"
+    std::string_view CmdArg::get_name() const
+    {
+        return long_name;
+    }
+
+    //The parsed values, or the default once the argument turns out not to have been given
+    const std::vector<std::string>& CmdArg::current_values() const
+    {
+        if (set or lazy_default == nullptr)
+            return values;
+
+        detail::LazyDefault& fallback = *lazy_default;
+        std::call_once(fallback.computed, [&fallback]() { fallback.values.assign(1, fallback.compute()); });
+
+        return fallback.values;
+    }
+
     std::string CmdArg::summary() const 
-    {  
+    {
+        Writer counter(nullptr, 0);
+        summary(counter);
+
+        std::string line(counter.required(), '\0');
+        Writer writer(line.data(), line.size());
+        summary(writer);
+
+        return line;
+    }
+
+    void CmdArg::summary(Writer& out) const
+    {
         //[Required] foo (--foo, -f):       foo is a placeholder argument
-        std::string prefix = enforced ? "[Required] " : "[Optional] ";
-        return prefix + identifier + " (" + long_name + ", " + short_name + "): " + "\t" + description;
+        //[Optional] codec (--codec, -c):   compression codec {zstd|lz4|none}
+        //[Optional] jobs (--jobs, -j):     parallel jobs [default: one per core]
+        out.append(enforced ? "[Required] " : "[Optional] ");
+        out.append(identifier).append(" (--").append(long_name).append(", -").append(short_name).append("): \t").append(description);
+
+        for (std::size_t i = 0; i < choice_count; ++i)
+        {
+            out.append(i == 0 ? " {" : "|");
+            out.append(choice_names[i]);
+        }
+
+        if (choice_count > 0)
+            out.append('}');
+
+        if (lazy_default != nullptr and not lazy_default->description.empty())
+            out.append(" [default: ").append(lazy_default->description).append(']');
     }
 }
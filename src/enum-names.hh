@@ -0,0 +1,221 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+/*
+    Enum-valued arguments are described by specializing `carp::enum_names` with a constexpr table
+    mapping each accepted spelling to its enumerator:
+
+        template <>
+        struct carp::enum_names<Codec>
+        {
+            static constexpr std::array<std::pair<std::string_view, Codec>, 3> values {{
+                {"zstd", Codec::Zstd}, {"lz4", Codec::Lz4}, {"none", Codec::None}
+            }};
+        };
+
+    From that table a perfect hash is generated at compile time (hash-and-displace: every name is
+    first hashed into a bucket, then each bucket gets its own seed that places its names into free,
+    distinct slots), so looking up a value costs one pass over the string and a single comparison.
+*/
+
+namespace carp
+{
+    template <typename E>
+    struct enum_names;
+
+    namespace detail
+    {
+        constexpr unsigned char to_lower(unsigned char c)
+        {
+            return (c >= 'A' and c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+
+        constexpr bool iequals(std::string_view a, std::string_view b)
+        {
+            if (a.length() != b.length())
+                return false;
+
+            for (std::size_t i = 0; i < a.length(); ++i)
+            {
+                if (to_lower(a[i]) != to_lower(b[i]))
+                    return false;
+            }
+
+            return true;
+        }
+
+        constexpr std::uint64_t mix(std::uint64_t h)
+        {
+            //MurmurHash3's 64-bit finalizer
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return h;
+        }
+
+        //FNV-1a over the lowercased bytes, so one table serves both case-sensitive and case-insensitive lookups
+        constexpr std::uint64_t fold_hash(std::string_view s)
+        {
+            std::uint64_t h = 14695981039346656037ull;
+            for (char c : s)
+            {
+                h ^= to_lower(c);
+                h *= 1099511628211ull;
+            }
+
+            return mix(h);
+        }
+
+        constexpr std::size_t next_pow2(std::size_t n)
+        {
+            std::size_t p = 1;
+            while (p < n)
+                p <<= 1;
+
+            return p;
+        }
+
+        template <std::size_t N>
+        struct PerfectHash
+        {
+            static_assert(N > 0, "[CARP] Error: enum_names<E>::values must contain at least one name");
+            static constexpr std::size_t slot_count = next_pow2(2 * N);
+            static constexpr std::uint32_t max_seed = 1u << 16;
+
+            std::array<std::uint32_t, N> seeds {};              //per-bucket displacement
+            std::array<std::size_t, slot_count> slots {};       //index into the name table + 1; 0 means empty
+            bool ok = false;
+
+            static constexpr std::size_t bucket(std::uint64_t h)
+            {
+                return (h >> 32) % N;
+            }
+
+            static constexpr std::size_t slot(std::uint64_t h, std::uint32_t seed)
+            {
+                return mix(h + seed) & (slot_count - 1);
+            }
+
+            constexpr std::size_t find(std::string_view name) const
+            {
+                std::uint64_t h = fold_hash(name);
+                return slots[slot(h, seeds[bucket(h)])];
+            }
+        };
+
+        template <std::size_t N>
+        constexpr PerfectHash<N> make_perfect_hash(const std::array<std::string_view, N>& names)
+        {
+            using Table = PerfectHash<N>;
+            Table table {};
+
+            std::array<std::uint64_t, N> hashes {};
+            std::array<std::size_t, N + 1> bucket_start {};
+            std::array<std::size_t, N> members {};
+            std::size_t largest_bucket = 0;
+
+            //Counting sort of the names by bucket, so each bucket's members are contiguous
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                hashes[i] = fold_hash(names[i]);
+                ++bucket_start[Table::bucket(hashes[i]) + 1];
+            }
+
+            for (std::size_t b = 0; b < N; ++b)
+            {
+                if (bucket_start[b + 1] > largest_bucket)
+                    largest_bucket = bucket_start[b + 1];
+
+                bucket_start[b + 1] += bucket_start[b];
+            }
+
+            std::array<std::size_t, N> fill = {};
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                std::size_t b = Table::bucket(hashes[i]);
+                members[bucket_start[b] + fill[b]++] = i;
+            }
+
+            //Place the largest buckets first; they are the hardest to fit
+            for (std::size_t size = largest_bucket; size > 0; --size)
+            {
+                for (std::size_t b = 0; b < N; ++b)
+                {
+                    if (bucket_start[b + 1] - bucket_start[b] != size)
+                        continue;
+
+                    bool placed = false;
+                    for (std::uint32_t seed = 0; seed < Table::max_seed and not placed; ++seed)
+                    {
+                        placed = true;
+                        for (std::size_t m = bucket_start[b]; m < bucket_start[b + 1] and placed; ++m)
+                        {
+                            std::size_t s = Table::slot(hashes[members[m]], seed);
+                            if (table.slots[s] != 0)
+                                placed = false;
+
+                            for (std::size_t k = bucket_start[b]; k < m; ++k)
+                            {
+                                if (Table::slot(hashes[members[k]], seed) == s)
+                                    placed = false;
+                            }
+                        }
+
+                        if (placed)
+                        {
+                            table.seeds[b] = seed;
+                            for (std::size_t m = bucket_start[b]; m < bucket_start[b + 1]; ++m)
+                                table.slots[Table::slot(hashes[members[m]], seed)] = members[m] + 1;
+                        }
+                    }
+
+                    //Only names that are equal ignoring case can never be separated
+                    if (not placed)
+                        return table;
+                }
+            }
+
+            table.ok = true;
+            return table;
+        }
+
+        template <typename E, std::size_t N>
+        constexpr std::array<std::string_view, N> names_of(const std::array<std::pair<std::string_view, E>, N>& values)
+        {
+            std::array<std::string_view, N> names {};
+            for (std::size_t i = 0; i < N; ++i)
+                names[i] = values[i].first;
+
+            return names;
+        }
+
+        template <typename E>
+        struct EnumTable
+        {
+            static constexpr auto names = names_of(enum_names<E>::values);
+            static constexpr auto hash = make_perfect_hash(names);
+            static_assert(hash.ok, "[CARP] Error: enum_names<E>::values must not contain names that are equal ignoring case");
+
+            static constexpr std::optional<E> find(std::string_view name, bool ignore_case)
+            {
+                std::size_t index = hash.find(name);
+                if (index == 0)
+                    return std::nullopt;
+
+                const auto& entry = enum_names<E>::values[index - 1];
+                if (ignore_case ? iequals(entry.first, name) : entry.first == name)
+                    return entry.second;
+
+                return std::nullopt;
+            }
+        };
+    }
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+/*
+    Storage for `ArgAction::StoreMap` arguments (-D key=value).
+
+    Every "key=value" entry is appended once to a single text buffer and never split into separate strings;
+    an open-addressing table (linear probing, at most half full) maps each key to the offsets of its key and
+    value inside that buffer, so a lookup is one hash of the key and, almost always, one comparison.
+    Keys are compared by bytes. Entries without an '=' are stored with an empty value.
+
+    A value that replaces one at least as long is written over it in place. Longer ones are appended, and once
+    more than half of the buffer is replaced entries it is rewritten with only the current ones, so repeating
+    "-D key=value" any number of times keeps the buffer within twice the size of what the map holds.
+*/
+
+namespace carp
+{
+    namespace detail
+    {
+        //Hashes a word at a time: multiply, then fold the high bits back down, since the low bits pick the slot
+        std::uint64_t hash_bytes(std::string_view key)
+        {
+            constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+            std::uint64_t h = key.size() * multiplier;
+
+            const char* cursor = key.data();
+            std::size_t remaining = key.size();
+
+            for (; remaining >= 8; cursor += 8, remaining -= 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, cursor, 8);
+                h = (h ^ word) * multiplier;
+                h ^= h >> 29;
+            }
+
+            if (remaining > 0)
+            {
+                std::uint64_t word = 0;
+                for (std::size_t i = 0; i < remaining; ++i)
+                    word |= std::uint64_t{static_cast<unsigned char>(cursor[i])} << (8 * i);
+
+                h = (h ^ word) * multiplier;
+                h ^= h >> 29;
+            }
+
+            return h ^ (h >> 32);
+        }
+    }
+
+    class FlatMap final
+    {
+        public:
+            void insert(std::string_view, bool);
+            std::optional<std::string_view> find(std::string_view) const;
+            std::size_t size() const;
+            void clear();
+
+            template <typename Function>
+            void for_each(Function&&) const;
+
+        private:
+            static constexpr std::uint32_t empty_slot = UINT32_MAX;
+
+            struct Slot
+            {
+                std::uint64_t hash;
+                std::uint32_t offset = empty_slot;  //where the key starts in `text`
+                std::uint32_t key_length;
+                std::uint32_t value_length;         //the value starts right after the key and its '='
+            };
+
+            static std::uint64_t hash(std::string_view);
+            std::size_t probe(std::string_view, std::uint64_t) const;
+            void grow();
+            void compact();
+
+            std::string text;
+            std::vector<Slot> slots;
+            std::size_t count = 0;
+            std::size_t replaced_bytes = 0;         //bytes of `text` that no slot points to anymore
+    };
+
+    std::uint64_t FlatMap::hash(std::string_view key)
+    {
+        return detail::hash_bytes(key);
+    }
+
+    //Index of the slot holding `key`, or of the empty slot where it would go
+    std::size_t FlatMap::probe(std::string_view key, std::uint64_t key_hash) const
+    {
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = key_hash & mask; ; i = (i + 1) & mask)
+        {
+            const Slot& slot = slots[i];
+            if (slot.offset == empty_slot)
+                return i;
+
+            if (slot.hash == key_hash and key == std::string_view(text.data() + slot.offset, slot.key_length))
+                return i;
+        }
+    }
+
+    void FlatMap::grow()
+    {
+        std::vector<Slot> old_slots(slots.empty() ? 16 : 2 * slots.size());
+        old_slots.swap(slots);
+
+        std::size_t mask = slots.size() - 1;
+        for (const Slot& slot : old_slots)
+        {
+            if (slot.offset == empty_slot)
+                continue;
+
+            std::size_t i = slot.hash & mask;
+            while (slots[i].offset != empty_slot)
+                i = (i + 1) & mask;
+
+            slots[i] = slot;
+        }
+    }
+
+    //Adds a "key=value" entry; a key that is already present only has its value replaced when `overwrite` is set
+    void FlatMap::insert(std::string_view entry, bool overwrite)
+    {
+        const char* separator = static_cast<const char*>(std::memchr(entry.data(), '=', entry.size()));
+        std::string_view key = entry.substr(0, separator ? separator - entry.data() : entry.size());
+        std::string_view value = separator ? entry.substr(key.size() + 1) : std::string_view();
+
+        if (2 * (count + 1) > slots.size())
+            grow();
+
+        std::uint64_t key_hash = hash(key);
+        Slot& slot = slots[probe(key, key_hash)];
+        bool exists = slot.offset != empty_slot;
+
+        if (exists and not overwrite)
+            return;
+
+        if (exists and value.size() <= slot.value_length)
+        {
+            value.copy(text.data() + slot.offset + slot.key_length + 1, value.size());
+            replaced_bytes += slot.value_length - value.size();
+            slot.value_length = static_cast<std::uint32_t>(value.size());
+            return;
+        }
+
+        //Offsets are 32 bits wide, and `empty_slot` is not one of them
+        if (text.size() + entry.size() + 1 >= empty_slot)
+        {
+            compact();
+            if (text.size() + entry.size() + 1 >= empty_slot)
+                throw std::length_error("the entries of a map argument exceed 4 GiB");
+        }
+
+        if (exists)
+            replaced_bytes += slot.key_length + 1 + slot.value_length;
+
+        slot.hash = key_hash;
+        slot.offset = static_cast<std::uint32_t>(text.size());
+        slot.key_length = static_cast<std::uint32_t>(key.size());
+        slot.value_length = static_cast<std::uint32_t>(value.size());
+
+        text.append(key).append(1, '=').append(value);
+        count += not exists;
+
+        if (2 * replaced_bytes > text.size())
+            compact();
+    }
+
+    //Rewrites `text` with the current entries only, dropping the ones that were replaced
+    void FlatMap::compact()
+    {
+        std::string current;
+        current.reserve(text.size() - replaced_bytes);
+
+        for (Slot& slot : slots)
+        {
+            if (slot.offset == empty_slot)
+                continue;
+
+            std::size_t offset = current.size();
+            current.append(text, slot.offset, slot.key_length + 1 + slot.value_length);
+            slot.offset = static_cast<std::uint32_t>(offset);
+        }
+
+        text.swap(current);
+        replaced_bytes = 0;
+    }
+
+    //The value is a view into the map and is invalidated by the next insert
+    std::optional<std::string_view> FlatMap::find(std::string_view key) const
+    {
+        if (slots.empty())
+            return std::nullopt;
+
+        const Slot& slot = slots[probe(key, hash(key))];
+        if (slot.offset == empty_slot)
+            return std::nullopt;
+
+        return std::string_view(text.data() + slot.offset + slot.key_length + 1, slot.value_length);
+    }
+
+    //Calls `visit(key, value)` for every entry, in no particular order
+    template <typename Function>
+    void FlatMap::for_each(Function&& visit) const
+    {
+        for (const Slot& slot : slots)
+        {
+            if (slot.offset != empty_slot)
+                visit(std::string_view(text.data() + slot.offset, slot.key_length), std::string_view(text.data() + slot.offset + slot.key_length + 1, slot.value_length));
+        }
+    }
+
+    std::size_t FlatMap::size() const
+    {
+        return count;
+    }
+
+    void FlatMap::clear()
+    {
+        text.clear();
+        slots.clear();
+        count = 0;
+        replaced_bytes = 0;
+    }
+}
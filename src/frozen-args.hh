@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <cstdint>
+
+#include "argument.hh"
+#include "flat-map.hh"
+
+/*
+    A read-only snapshot of a parser's arguments, for reading them from many threads at once.
+
+    `Parser::get_arg` hands out shared_ptrs, so every read from a worker thread increments and decrements the
+    same reference count, and the threads fight over that cache line. `Parser::freeze()` copies the arguments
+    into a FrozenArgs once parsing is done, and its lookups return plain references, with no atomics and no
+    writes to memory at all. Every name an argument answers to ("threads", "--jobs", "-j") is a key of a single
+    immutable table, so a lookup is one hash and, almost always, one comparison. Every argument, and every group
+    of four table slots, starts on a cache line of its own.
+
+    The snapshot does not change when the parser parses again. The strings the arguments were defined with
+    must outlive it, as with `CmdArg`.
+*/
+
+namespace carp
+{
+    class FrozenArgs final
+    {
+        public:
+            const CmdArg* find_arg(std::string_view) const;
+            const CmdArg& get_arg(std::string_view) const;
+            bool arg_exists(std::string_view) const;
+            std::size_t size() const;
+
+            friend class Parser;
+
+        private:
+            static constexpr std::size_t cache_line = 64;
+            static constexpr std::uint32_t no_arg = UINT32_MAX;
+
+            struct alignas(cache_line) AlignedArg
+            {
+                CmdArg arg;
+            };
+
+            struct Slot
+            {
+                std::uint32_t hash;
+                std::uint32_t offset;               //where the name starts in `names`
+                std::uint32_t length;
+                std::uint32_t index = no_arg;       //into `args`
+            };
+
+            static constexpr std::size_t slots_per_bucket = cache_line / sizeof(Slot);
+
+            struct alignas(cache_line) Bucket
+            {
+                Slot slots[slots_per_bucket];
+            };
+
+            void add_name(std::string_view, std::string_view, std::uint32_t);
+            void build_table();
+            Slot& slot(std::size_t);
+            const Slot& slot(std::size_t) const;
+
+            std::vector<AlignedArg> args;
+            std::string names;                              //every name, with its dashes, one after another
+            std::vector<Slot> pending;                      //names added since the last `build_table`
+            std::vector<Bucket> buckets;                    //open addressing, linear probing, at most half full
+            std::size_t mask = 0;
+    };
+
+    FrozenArgs::Slot& FrozenArgs::slot(std::size_t i)
+    {
+        return buckets[i / slots_per_bucket].slots[i % slots_per_bucket];
+    }
+
+    const FrozenArgs::Slot& FrozenArgs::slot(std::size_t i) const
+    {
+        return buckets[i / slots_per_bucket].slots[i % slots_per_bucket];
+    }
+
+    //Adds `prefix` + `name` as a name of `args[index]`; of several arguments with the same name, the first one added keeps it
+    void FrozenArgs::add_name(std::string_view prefix, std::string_view name, std::uint32_t index)
+    {
+        Slot entry;
+        entry.offset = static_cast<std::uint32_t>(names.size());
+        entry.length = static_cast<std::uint32_t>(prefix.size() + name.size());
+        entry.index = index;
+
+        names.append(prefix).append(name);
+        entry.hash = static_cast<std::uint32_t>(detail::hash_bytes(std::string_view(names).substr(entry.offset)));
+        pending.push_back(entry);
+    }
+
+    void FrozenArgs::build_table()
+    {
+        std::size_t capacity = slots_per_bucket;
+        while (capacity < 2 * pending.size())
+            capacity *= 2;
+
+        buckets.assign(capacity / slots_per_bucket, Bucket());
+        mask = capacity - 1;
+
+        for (const Slot& entry : pending)
+        {
+            std::string_view name(names.data() + entry.offset, entry.length);
+            std::size_t i = entry.hash & mask;
+
+            while (slot(i).index != no_arg and name != std::string_view(names.data() + slot(i).offset, slot(i).length))
+                i = (i + 1) & mask;
+
+            if (slot(i).index == no_arg)
+                slot(i) = entry;
+        }
+
+        pending.clear();
+        pending.shrink_to_fit();
+    }
+
+    const CmdArg* FrozenArgs::find_arg(std::string_view name) const
+    {
+        if (buckets.empty())
+            return nullptr;
+
+        std::uint32_t hash = static_cast<std::uint32_t>(detail::hash_bytes(name));
+        for (std::size_t i = hash & mask; ; i = (i + 1) & mask)
+        {
+            const Slot& candidate = slot(i);
+            if (candidate.index == no_arg)
+                return nullptr;
+
+            if (candidate.hash == hash and name == std::string_view(names.data() + candidate.offset, candidate.length))
+                return &args[candidate.index].arg;
+        }
+    }
+
+    //Resolves `name` the way `Parser::get_arg` does: as an identifier, "--<long name>" or "-<short name>"
+    const CmdArg& FrozenArgs::get_arg(std::string_view name) const
+    {
+        if (const CmdArg* arg = find_arg(name))
+            return *arg;
+
+        throw std::out_of_range("no argument named '" + std::string(name) + "'");
+    }
+
+    bool FrozenArgs::arg_exists(std::string_view name) const
+    {
+        return find_arg(name) != nullptr;
+    }
+
+    std::size_t FrozenArgs::size() const
+    {
+        return args.size();
+    }
+}
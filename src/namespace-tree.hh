@@ -0,0 +1,257 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+
+#include "argument.hh"
+#include "writer.hh"
+
+/*
+    Dotted long names such as "--db.pool.size" put arguments into namespaces ("db", then "db.pool").
+
+    The parser keeps a trie of the names, one node per segment, flattened into arrays: the nodes in depth-first
+    order, each knowing where its subtree ends, the children of every node as one sorted run of indices, and the
+    arguments sorted so that every subtree's arguments are contiguous as well. Finding a namespace binary-searches
+    the children once per segment, and all of its arguments are then a single range, so a subsystem gets its whole
+    subtree in O(depth * log(children per node)), however many options and sibling namespaces there are.
+*/
+
+namespace carp
+{
+    //A run of arguments, e.g. every option under "db.pool"; only valid until arguments are added or removed
+    class ArgumentSubtree final
+    {
+        public:
+            ArgumentSubtree(const CmdArg* const*, const CmdArg* const*);
+
+            const CmdArg* const* begin() const;
+            const CmdArg* const* end() const;
+            std::size_t size() const;
+            bool empty() const;
+
+        private:
+            const CmdArg* const* first;
+            const CmdArg* const* last;
+    };
+
+    ArgumentSubtree::ArgumentSubtree(const CmdArg* const* begin = nullptr, const CmdArg* const* end = nullptr)
+    {
+        first = begin;
+        last = end;
+    }
+
+    const CmdArg* const* ArgumentSubtree::begin() const
+    {
+        return first;
+    }
+
+    const CmdArg* const* ArgumentSubtree::end() const
+    {
+        return last;
+    }
+
+    std::size_t ArgumentSubtree::size() const
+    {
+        return last - first;
+    }
+
+    bool ArgumentSubtree::empty() const
+    {
+        return first == last;
+    }
+
+    namespace detail
+    {
+        class NamespaceTree final
+        {
+            public:
+                void build(std::vector<const CmdArg*>);
+                void clear();
+                bool empty() const;
+
+                ArgumentSubtree find(std::string_view) const;
+                void format(Writer&) const;
+
+            private:
+                struct Node
+                {
+                    std::string_view segment;
+                    std::uint32_t end;              //one past the last node of the subtree, i.e. the next sibling
+                    std::uint32_t path_length;      //the length of the full name up to this node, e.g. 7 for "db.pool"
+                    std::uint32_t arg_begin;        //the arguments named exactly like the node come first,
+                    std::uint32_t own_end;          //then those of every descendant
+                    std::uint32_t arg_end;
+                    std::uint32_t children_begin;   //the node's children, in `children`, sorted by segment
+                    std::uint32_t children_end;
+                };
+
+                static bool namespace_order(const CmdArg*, const CmdArg*);
+                void add_node(std::string_view, std::size_t, std::uint32_t, std::uint32_t);
+                void format_group(Writer&, std::uint32_t) const;
+
+                std::vector<Node> nodes;
+                std::vector<std::uint32_t> children;
+                std::vector<const CmdArg*> args;
+        };
+
+        /*
+            Sorts by name, segment by segment: '.' comes before every other character, so that "db.pool" and everything
+            under it ("db.pool.size") stay together ahead of siblings like "db.pool-limit". Ties keep the identifier order.
+        */
+        bool NamespaceTree::namespace_order(const CmdArg* lhs, const CmdArg* rhs)
+        {
+            std::string_view left = lhs->get_name();
+            std::string_view right = rhs->get_name();
+
+            auto rank = [](char c) { return c == '.' ? 0 : static_cast<unsigned char>(c) + 1; };
+            auto mismatch = std::mismatch(left.begin(), left.end(), right.begin(), right.end());
+
+            if (mismatch.first != left.end() and mismatch.second != right.end())
+                return rank(*mismatch.first) < rank(*mismatch.second);
+
+            if (left.size() != right.size())
+                return left.size() < right.size();
+
+            return lhs->get_identifier() < rhs->get_identifier();
+        }
+
+        void NamespaceTree::build(std::vector<const CmdArg*> arguments)
+        {
+            std::sort(arguments.begin(), arguments.end(), namespace_order);
+
+            args = std::move(arguments);
+            nodes.clear();
+            children.clear();
+            add_node(std::string_view(), 0, 0, static_cast<std::uint32_t>(args.size()));
+        }
+
+        //Adds the node for `args[begin, end)`, whose names all start with the same `path_length` characters, and its subtree
+        void NamespaceTree::add_node(std::string_view segment, std::size_t path_length, std::uint32_t begin, std::uint32_t end)
+        {
+            std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back({segment, 0, static_cast<std::uint32_t>(path_length), begin, begin, end, 0, 0});
+
+            std::uint32_t cursor = begin;
+            while (cursor < end and args[cursor]->get_name().size() == path_length)
+                ++cursor;
+
+            nodes[index].own_end = cursor;
+
+            //The names left over continue with a '.' (except at the root) and the segment of a child
+            std::size_t segment_start = path_length == 0 ? 0 : path_length + 1;
+            auto segment_of = [segment_start](const CmdArg* arg)
+            {
+                std::string_view name = arg->get_name();
+                return name.substr(segment_start, name.find('.', segment_start) - segment_start);
+            };
+
+            //The arguments are sorted, so the children come in order of their segments
+            std::vector<std::uint32_t> own_children;
+            while (cursor < end)
+            {
+                std::string_view child = segment_of(args[cursor]);
+                std::uint32_t child_end = cursor + 1;
+
+                while (child_end < end and segment_of(args[child_end]) == child)
+                    ++child_end;
+
+                own_children.push_back(static_cast<std::uint32_t>(nodes.size()));
+                add_node(child, segment_start + child.size(), cursor, child_end);
+                cursor = child_end;
+            }
+
+            nodes[index].end = static_cast<std::uint32_t>(nodes.size());
+            nodes[index].children_begin = static_cast<std::uint32_t>(children.size());
+            children.insert(children.end(), own_children.begin(), own_children.end());
+            nodes[index].children_end = static_cast<std::uint32_t>(children.size());
+        }
+
+        void NamespaceTree::clear()
+        {
+            nodes.clear();
+            children.clear();
+            args.clear();
+        }
+
+        bool NamespaceTree::empty() const
+        {
+            return nodes.empty();
+        }
+
+        //Every argument named `path` or under it, e.g. "db.pool" gives "--db.pool.size" and "--db.pool.timeout"; "" gives all of them
+        ArgumentSubtree NamespaceTree::find(std::string_view path) const
+        {
+            if (nodes.empty())
+                return ArgumentSubtree();
+
+            std::uint32_t index = 0;
+            while (not path.empty())
+            {
+                std::size_t dot = path.find('.');
+                std::string_view segment = path.substr(0, dot);
+                path = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+
+                const std::uint32_t* first = children.data() + nodes[index].children_begin;
+                const std::uint32_t* last = children.data() + nodes[index].children_end;
+                const std::uint32_t* child = std::lower_bound(first, last, segment, [this](std::uint32_t node, std::string_view key) { return nodes[node].segment < key; });
+
+                if (child == last or nodes[*child].segment != segment)
+                    return ArgumentSubtree();
+
+                index = *child;
+            }
+
+            return ArgumentSubtree(args.data() + nodes[index].arg_begin, args.data() + nodes[index].arg_end);
+        }
+
+        /*
+            One block per namespace, each headed by its name, with the arguments directly in it sorted by name:
+
+                [Optional] help (--help, -h):          displays this help screen
+
+                db.pool:
+                [Optional] size (--db.pool.size, -s):  connections in the pool
+        */
+        void NamespaceTree::format(Writer& out) const
+        {
+            if (nodes.empty())
+                return;
+
+            //Arguments with an empty long name
+            for (std::uint32_t i = nodes[0].arg_begin; i < nodes[0].own_end; ++i)
+            {
+                args[i]->summary(out);
+                out.append('\n');
+            }
+
+            format_group(out, 0);
+        }
+
+        void NamespaceTree::format_group(Writer& out, std::uint32_t index) const
+        {
+            const Node& node = nodes[index];
+            bool has_header = false;
+
+            for (std::uint32_t child = index + 1; child < node.end; child = nodes[child].end)
+            {
+                for (std::uint32_t i = nodes[child].arg_begin; i < nodes[child].own_end; ++i)
+                {
+                    if (index != 0 and not has_header)
+                        out.append('\n').append(args[i]->get_name().substr(0, node.path_length)).append(":\n");
+
+                    has_header = true;
+                    args[i]->summary(out);
+                    out.append('\n');
+                }
+            }
+
+            for (std::uint32_t child = index + 1; child < node.end; child = nodes[child].end)
+            {
+                if (nodes[child].end > child + 1)
+                    format_group(out, child);
+            }
+        }
+    }
+}
@@ -1,21 +1,43 @@
 #pragma once
 
-#include <iostream>
-#include <iomanip>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <unordered_map>
-#include <regex>
 #include <type_traits>
 #include <cstdlib>
 #include <stdexcept>
+#include <vector>
+#include <list>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <tuple>
 
 #include "argument.hh"
 #include "program-info.hh"
+#include "tokenizer.hh"
+#include "suggestions.hh"
+#include "utf8.hh"
+#include "frozen-args.hh"
+#include "namespace-tree.hh"
+#include "writer.hh"
 
 namespace carp
 {
+    /*
+        One entry of the occurrence log (see `Parser::occurrences`): an option or a value it took, in the order
+        they appeared on the command line. Values are views into argv, or into the parsed line and the parser's
+        tokenizer for `parse(std::string_view)`, and are only valid as long as those are.
+    */
+    struct Occurrence
+    {
+        const CmdArg* arg;
+        std::string_view value;     //the value given to `arg`, or "key=value" for "-Dkey=value"; empty for the option itself
+        std::size_t index;          //position in argv, or among the tokens of a parsed line
+        bool is_option;             //whether this is the option itself rather than one of its values
+    };
+
     class Parser final
     {
         public:
@@ -25,39 +47,102 @@ namespace carp
             template <typename ...Args>
             Parser(ProgramInfo, Args...);
 
+            std::size_t add_arguments(const CmdArgSpec*, std::size_t);
+            std::size_t add_arguments(const std::vector<CmdArgSpec>&);
+            void remove_arguments(std::size_t);
+
             void parse(int, char*[]);
+            void parse(std::string_view);
+            void parse_parallel(int, char*[], unsigned int);
+            void require_utf8(bool);
+            void validation_threads(unsigned int);
             void validate_required_args() const;
-            const bool arg_exists(std::string) const;
-            const std::shared_ptr<CmdArg> get_arg(std::string) const;  //TODO: change to 'std::shared_ptr<const CmdArg>' (const in wrong spot)
+            void validate_values() const;
+            const bool arg_exists(std::string_view) const;
+            const std::shared_ptr<CmdArg> get_arg(std::string_view) const;  //TODO: change to 'std::shared_ptr<const CmdArg>' (const in wrong spot)
+            std::optional<std::string_view> get_map_value(std::string_view, std::string_view) const;
+            const std::vector<Occurrence>& occurrences() const;
+            FrozenArgs freeze() const;
+            ArgumentSubtree get_namespace(std::string_view) const;
             void help() const;
+            std::size_t format_help(char*, std::size_t) const;
+            bool write_help(int) const;
 
             #ifdef CARP_DEBUG
             void print_all_arguments() const;
             #endif
 
         private:
+            enum class TokenKind
+            {
+                Value,
+                Option,
+                MapEntry,
+                Unknown,
+                Help
+            };
+
+            struct ParseState
+            {
+                CmdArg* arg = nullptr;                      //the most recent option, which receives the values that follow it
+                std::size_t index = 0;                      //position of the current token, for the occurrence log
+                std::vector<std::string_view> unknown_args;
+            };
+
+            void reserve_arguments(std::size_t);
+            void register_argument(const std::shared_ptr<CmdArg>&);
+            void reset_arguments();
+            const std::shared_ptr<CmdArg>* find_arg(std::string_view) const;
+            void parse_token(std::string_view, ParseState&);
+            void check_utf8(std::string_view, std::size_t) const;
+            std::pair<TokenKind, CmdArg*> classify_token(std::string_view) const;
+            void apply_option(CmdArg*);
+            void apply_value(CmdArg*, std::string_view);
+            static bool is_help(std::string_view);
+            static bool takes_values(const CmdArg*);
+
+            template <typename Function>
+            static void run_in_parallel(std::size_t, const Function&);
+            CmdArg* find_attached_map_arg(std::string_view) const;
+            void validate_known_args(const std::vector<std::string_view>&) const;
+            void format_help(Writer&) const;
+            const detail::NamespaceTree& namespaces() const;
+
             ProgramInfo program_info;
-            std::unordered_map<std::string, std::shared_ptr<CmdArg>> arguments;
-            std::unordered_map<std::string, std::shared_ptr<CmdArg>> argument_aliases;
+            Tokenizer tokenizer;
+            std::vector<Occurrence> occurrence_log;
+            bool utf8_required = false;
+            unsigned int validation_thread_limit = 0;
+            std::unordered_map<std::string_view, std::shared_ptr<CmdArg>> arguments;
+            std::unordered_map<std::string_view, std::shared_ptr<CmdArg>> argument_aliases;        //long names, without the "--"
+            std::unordered_map<std::string_view, std::shared_ptr<CmdArg>> argument_abbreviations;  //short names, without the "-"
+            std::vector<CmdArg*> map_arguments;                                                     //`StoreMap` arguments, which also accept "-Dkey=value"
+
+            //Arguments added at runtime by `add_arguments`, one contiguous block per call
+            std::unordered_map<std::size_t, std::shared_ptr<std::vector<CmdArg>>> argument_groups;
+            std::size_t next_argument_group = 0;
+
+            //Built the first time an unknown argument is reported
+            mutable detail::Suggestions long_name_suggestions;
+            mutable detail::Suggestions short_name_suggestions;
+
+            //Built the first time a namespace is looked up or the help screen is shown
+            mutable detail::NamespaceTree namespace_tree;
     };
 
     template <typename ...Args>
     Parser::Parser(Args... args)
     {
         static_assert((std::is_same_v<Args, std::shared_ptr<CmdArg>> and ...), "[CARP] Error: Parser constructor only accepts std::shared_ptr<carp::CmdArg> objects! Did you forget the '.build()' on the end of any CmdArgs?");
-        (arguments.insert({args->identifier, args}), ...);
-        (argument_aliases.insert({args->long_name, args}), ...);
-        (argument_aliases.insert({args->short_name, args}), ...);
-        
+        reserve_arguments(sizeof...(Args) + 1);
+        (register_argument(args), ...);
 
         std::shared_ptr<CmdArg> help = CmdArg("help")
                                             .abbreviation("h")
                                             .help("displays this help screen")
                                             .build();
 
-        arguments.insert({help->identifier, help});
-        argument_aliases.insert({help->long_name, help});
-        argument_aliases.insert({help->short_name, help});
+        register_argument(help);
     }
 
     template <typename ...Args>
@@ -67,78 +152,698 @@ namespace carp
         
         program_info = info;
 
-        (arguments.insert({args->identifier, args}), ...);
-        (argument_aliases.insert({args->long_name, args}), ...);
-        (argument_aliases.insert({args->short_name, args}), ...);
-        
+        reserve_arguments(sizeof...(Args) + 1);
+        (register_argument(args), ...);
 
         std::shared_ptr<CmdArg> help = CmdArg("help")
                                             .abbreviation("h")
                                             .help("displays this help screen")
                                             .build();
 
-        arguments.insert({help->identifier, help});
-        argument_aliases.insert({help->long_name, help});
-        argument_aliases.insert({help->short_name, help});
+        register_argument(help);
+    }
+
+    /*
+        Registers a whole set of arguments at runtime, e.g. the options of a plugin that was just loaded, and returns
+        a handle that `remove_arguments` accepts to unregister them again. All of the arguments are stored in one
+        block (each `get_arg` result shares ownership of it), and the lookup tables grow once for the whole set.
+        The strings in the specs must outlive the arguments, as with `CmdArg`.
+    */
+    std::size_t Parser::add_arguments(const CmdArgSpec* specs, std::size_t count)
+    {
+        auto group = std::make_shared<std::vector<CmdArg>>();
+        group->reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const CmdArgSpec& spec = specs[i];
+            group->push_back(CmdArg(spec.identifier)
+                                    .name(spec.name.empty() ? spec.identifier : spec.name)
+                                    .abbreviation(spec.abbreviation.empty() ? spec.identifier : spec.abbreviation)
+                                    .help(spec.help)
+                                    .required(spec.required)
+                                    .action(spec.action));
+        }
+
+        reserve_arguments(count);
+        for (CmdArg& arg : *group)
+            register_argument(std::shared_ptr<CmdArg>(group, &arg));
+
+        argument_groups.emplace(next_argument_group, std::move(group));
+        return next_argument_group++;
+    }
+
+    std::size_t Parser::add_arguments(const std::vector<CmdArgSpec>& specs)
+    {
+        return add_arguments(specs.data(), specs.size());
+    }
+
+    /*
+        Unregisters every argument added by one call to `add_arguments`; unknown handles are ignored. Names the group
+        had claimed pass to the next argument, in the order they were added, that was shadowed by them, and the
+        occurrences of its arguments leave the log, which would otherwise point into the freed group.
+    */
+    void Parser::remove_arguments(std::size_t handle)
+    {
+        auto group = argument_groups.find(handle);
+        if (group == argument_groups.end())
+            return;
+
+        //Names that were already taken when the group was added still belong to the earlier argument
+        auto erase_if_owned = [](auto& table, std::string_view key, const CmdArg* arg)
+        {
+            auto entry = table.find(key);
+            if (entry != table.end() and entry->second.get() == arg)
+                table.erase(entry);
+        };
+
+        const CmdArg* first = group->second->data();
+        const CmdArg* last = first + group->second->size();
+
+        for (const CmdArg& arg : *group->second)
+        {
+            erase_if_owned(arguments, arg.identifier, &arg);
+            erase_if_owned(argument_aliases, arg.long_name, &arg);
+            erase_if_owned(argument_abbreviations, arg.short_name, &arg);
+        }
+
+        map_arguments.erase(std::remove_if(map_arguments.begin(), map_arguments.end(), [&](const CmdArg* arg) { return arg >= first and arg < last; }),
+                            map_arguments.end());
+        occurrence_log.erase(std::remove_if(occurrence_log.begin(), occurrence_log.end(), [&](const Occurrence& occurrence) { return occurrence.arg >= first and occurrence.arg < last; }),
+                             occurrence_log.end());
+
+        argument_groups.erase(group);
+
+        //Only groups added later can have been shadowed; registering them again in order fills exactly the freed names
+        std::vector<std::size_t> later_groups;
+        for (const auto& [later, _] : argument_groups)
+        {
+            if (later > handle)
+                later_groups.push_back(later);
+        }
+
+        std::sort(later_groups.begin(), later_groups.end());
+        for (std::size_t later : later_groups)
+        {
+            const std::shared_ptr<std::vector<CmdArg>>& storage = argument_groups[later];
+            for (CmdArg& arg : *storage)
+            {
+                std::shared_ptr<CmdArg> shared(storage, &arg);
+                arguments.insert({arg.identifier, shared});
+                argument_aliases.insert({arg.long_name, shared});
+                argument_abbreviations.insert({arg.short_name, shared});
+            }
+        }
+
+        long_name_suggestions.clear();
+        short_name_suggestions.clear();
+        namespace_tree.clear();
+    }
+
+    void Parser::reserve_arguments(std::size_t count)
+    {
+        arguments.reserve(arguments.size() + count);
+        argument_aliases.reserve(argument_aliases.size() + count);
+        argument_abbreviations.reserve(argument_abbreviations.size() + count);
+    }
+
+    //The first argument to claim an identifier or name keeps it
+    void Parser::register_argument(const std::shared_ptr<CmdArg>& arg)
+    {
+        arguments.insert({arg->identifier, arg});
+        argument_aliases.insert({arg->long_name, arg});
+        argument_abbreviations.insert({arg->short_name, arg});
+
+        if (arg->on_parse == ArgAction::StoreMap)
+            map_arguments.push_back(arg.get());
+
+        long_name_suggestions.clear();
+        short_name_suggestions.clear();
+        namespace_tree.clear();
+    }
+
+    /*
+        Forgets what the previous parse stored, so that every parse reports only the arguments it was given; the values
+        keep their storage for the next one. A parse reaches arguments through their long and short names, and through
+        `map_arguments` for "-Dkey=value", so those cover every argument it can have set.
+    */
+    void Parser::reset_arguments()
+    {
+        auto reset = [](CmdArg& arg)
+        {
+            arg.set = false;
+            arg.count = 0;
+            arg.values.clear();
+            arg.entries.clear();
+        };
+
+        for (const auto& [_, arg] : argument_aliases)
+            reset(*arg);
+
+        for (const auto& [_, arg] : argument_abbreviations)
+            reset(*arg);
+
+        for (CmdArg* arg : map_arguments)
+            reset(*arg);
+
+        occurrence_log.clear();
     }
 
     void Parser::parse(int argc, char* argv[])
     {
-        /*NOTE: the simpler regex "^(-|--)[a-zA-Z-]+$" causes the corner case
-        of '--' to be recognized as a valid commandline argument, which violates
-        POSIX Utility Syntax Guideline 10:*/
-        const static std::regex arg_pattern(R"(^(-|--)[a-zA-Z]+[a-zA-Z-]*$)");
-        std::shared_ptr<CmdArg> arg = nullptr;  
+        ParseState state;
+        reset_arguments();
+
+        if (utf8_required)
+        {
+            for (int i = 1; i < argc and not is_help(argv[i]); ++i)
+                check_utf8(argv[i], i);
+        }
+
+        //Every token adds at most one entry, so the log never reallocates during a parse
+        occurrence_log.reserve(argc);
 
         for(int i=1; i < argc; ++i)
         {
-            std::string cmdarg = argv[i];
-            if (std::regex_match(cmdarg, std::regex(R"(^(-|--)help$)")))
-                    help();
+            state.index = i;
+            parse_token(argv[i], state);
+        }
+
+        validate_known_args(state.unknown_args);
+        validate_required_args();
+        validate_values();
+    }
+
+    /*
+        Parses the arguments in a single command line, e.g. one read by a REPL or received over a socket.
+        The line is split like a POSIX shell would (see tokenizer.hh) and, unlike argv, contains no program name.
+        Like every parse, it starts over: nothing from the previous line stays set.
+    */
+    void Parser::parse(std::string_view line)
+    {
+        ParseState state;
+        const std::vector<std::string_view>& tokens = tokenizer.split(line);
+
+        reset_arguments();
+
+        if (utf8_required)
+        {
+            for (std::size_t i = 0; i < tokens.size() and not is_help(tokens[i]); ++i)
+                check_utf8(tokens[i], i);
+        }
+
+        occurrence_log.reserve(tokens.size());
+
+        for (; state.index < tokens.size(); ++state.index)
+            parse_token(tokens[state.index], state);
+
+        validate_known_args(state.unknown_args);
+        validate_required_args();
+        validate_values();
+    }
+
+    /*
+        Makes every parse reject arguments, options and values alike, that are not valid UTF-8, naming the position
+        of the first such argument and the offset of its first invalid byte. The arguments are checked before any of
+        them is stored, so a rejected parse leaves every argument unset, whether it ran serially or in parallel; only
+        a "--help" in front of the invalid argument comes first.
+    */
+    void Parser::require_utf8(bool required = true)
+    {
+        utf8_required = required;
+    }
 
-            if (std::regex_match(cmdarg, arg_pattern) and arg_exists(cmdarg))
+    /*
+        The most threads `validate_values` runs validators on, the calling thread included; 0 (the default) picks
+        twice the number of cores, and at least 4. 1 runs every check on the calling thread.
+    */
+    void Parser::validation_threads(unsigned int count = 0)
+    {
+        validation_thread_limit = count;
+    }
+
+    void Parser::parse_token(std::string_view cmdarg, ParseState& state)
+    {
+        auto [kind, option] = classify_token(cmdarg);
+
+        switch (kind)
+        {
+            case TokenKind::Help:
+                help();
+                break;
+
+            case TokenKind::Option:
+                state.arg = option;
+                apply_option(option);
+                occurrence_log.push_back({option, std::string_view(), state.index, true});
+                break;
+
+            //"-Dkey=value": the entry is attached to the abbreviation, and nothing after it belongs to the map
+            case TokenKind::MapEntry:
             {
-                arg = get_arg(cmdarg);
-                arg->set = true;
+                std::string_view entry = cmdarg.substr(1 + option->short_name.size());
+                option->set = true;
+                option->entries.insert(entry, option->duplicate_keys == MapPolicy::LastWins);
+                occurrence_log.push_back({option, entry, state.index, false});
+                state.arg = nullptr;
+                break;
+            }
+
+            case TokenKind::Unknown:
+                state.unknown_args.push_back(cmdarg);
+                break;
 
-                switch (arg->on_parse)
+            case TokenKind::Value:
+                if (state.arg != nullptr and takes_values(state.arg))
                 {
-                    case ArgAction::SetTrue:
-                        arg->values[0] = "true";
-                        break;
+                    apply_value(state.arg, cmdarg);
+                    occurrence_log.push_back({state.arg, cmdarg, state.index, false});
+                }
+                break;
+        }
+    }
 
-                    case ArgAction::SetFalse:
-                        arg->values[0] = "false";
-                        break;
+    //Decides what a token is without changing any state, so that tokens can be classified concurrently
+    std::pair<Parser::TokenKind, CmdArg*> Parser::classify_token(std::string_view cmdarg) const
+    {
+        if (is_help(cmdarg))
+            return {TokenKind::Help, nullptr};
 
-                    case ArgAction::Count:
-                        arg->count++;
-                        break;
+        //Registered names are options whatever they contain (e.g. "--2fa", which starts with a digit); the shape
+        //only decides whether an unregistered token is an unknown option or a value
+        bool is_option = detail::is_option_token(cmdarg);
+        if (const std::shared_ptr<CmdArg>* option = cmdarg.substr(0, 1) == "-" ? find_arg(cmdarg) : nullptr)
+            return {TokenKind::Option, option->get()};
+
+        if (CmdArg* map_arg = find_attached_map_arg(cmdarg))
+            return {TokenKind::MapEntry, map_arg};
+
+        return {is_option ? TokenKind::Unknown : TokenKind::Value, nullptr};
+    }
+
+    void Parser::apply_option(CmdArg* arg)
+    {
+        arg->set = true;
+
+        switch (arg->on_parse)
+        {
+            case ArgAction::SetTrue:
+                arg->values.assign(1, "true");
+                break;
+
+            case ArgAction::SetFalse:
+                arg->values.assign(1, "false");
+                break;
+
+            case ArgAction::Count:
+                arg->count++;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void Parser::apply_value(CmdArg* arg, std::string_view cmdarg)
+    {
+        switch (arg->on_parse)
+        {
+            case ArgAction::StoreSingle:
+                if (arg->values.empty())
+                    arg->values.emplace_back(cmdarg);
+                else
+                    arg->values[0] = cmdarg;
+                break;
+
+            case ArgAction::StoreMany:
+                arg->values.emplace_back(cmdarg);
+                break;
+
+            case ArgAction::StoreMap:
+                arg->entries.insert(cmdarg, arg->duplicate_keys == MapPolicy::LastWins);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    //Throws if `cmdarg`, the argument at `index`, is not valid UTF-8, e.g. "... UTF-8: #2 'caf\xE9' (byte 3)"
+    void Parser::check_utf8(std::string_view cmdarg, std::size_t index) const
+    {
+        std::size_t offset = detail::find_invalid_utf8(cmdarg);
+        if (offset == cmdarg.size())
+            return;
+
+        //Everything before the offset is valid; the invalid byte is shown as an escape, and what follows is cut off
+        constexpr char hex_digits[] = "0123456789ABCDEF";
+        unsigned char invalid = static_cast<unsigned char>(cmdarg[offset]);
+        char escape[] { '\\', 'x', hex_digits[invalid >> 4], hex_digits[invalid & 0xF] };
+
+        std::string argument_error = "#" + std::to_string(index) + " '";
+        argument_error.append(cmdarg.substr(0, offset)).append(escape, sizeof(escape));
+        argument_error.append(offset + 1 < cmdarg.size() ? "...' (byte " : "' (byte ").append(std::to_string(offset)).append(")");
+
+        throw std::runtime_error("the following argument is not valid UTF-8: " + argument_error);
+    }
+
+    bool Parser::is_help(std::string_view cmdarg)
+    {
+        return cmdarg == "--help" or cmdarg == "-help";
+    }
+
+    //Whether the values following the option are stored, rather than ignored
+    bool Parser::takes_values(const CmdArg* arg)
+    {
+        return arg->on_parse == ArgAction::StoreSingle or arg->on_parse == ArgAction::StoreMany or arg->on_parse == ArgAction::StoreMap;
+    }
+
+    /*
+        Opt-in parallel version of `parse(argc, argv)` for argument vectors with millions of tokens, e.g. ones
+        expanded from response files. The result is identical to the serial parse, including the order of
+        StoreMany values and Count totals:
+          1. every chunk of tokens is classified concurrently (the expensive part: pattern match and lookup)
+          2. the option that each chunk's first values belong to is the last option of an earlier chunk; a
+             scan over the chunks (not the tokens) resolves it
+          3. every chunk tallies what it contributes to each argument, concurrently
+          4. the tallies are merged in chunk order, which gives every chunk its own slice of each StoreMany
+             argument's values
+          5. every chunk writes its values into its own slices concurrently, without any locking, and likewise
+             its entries of the occurrence log, whose offsets come from the same merge
+        Short argument vectors are parsed serially, since threads would cost more than they save.
+    */
+    void Parser::parse_parallel(int argc, char* argv[], unsigned int thread_count = 0)
+    {
+        constexpr std::size_t min_tokens_per_chunk = 16384;
+
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        std::size_t token_count = argc > 1 ? argc - 1 : 0;
+        std::size_t chunk_count = std::min<std::size_t>(thread_count, token_count / min_tokens_per_chunk);
+        if (chunk_count <= 1)
+        {
+            parse(argc, argv);
+            return;
+        }
+
+        reset_arguments();
+
+        struct Token
+        {
+            std::string_view text;
+            TokenKind kind;
+            CmdArg* arg;
+        };
+
+        //What one chunk contributes to one argument
+        struct Tally
+        {
+            unsigned int options = 0;
+            std::size_t values = 0;
+            std::string_view last_value;
+            std::size_t next_slot = 0;          //where the chunk's next StoreMany value goes
+        };
+
+        struct Chunk
+        {
+            std::size_t begin;
+            std::size_t end;
+            bool changes_arg = false;           //whether the chunk has an option (or "-Dkey=value") at all
+            CmdArg* last_arg = nullptr;         //the current option after the chunk, if it changes it
+            CmdArg* first_arg = nullptr;        //the current option before the chunk
+            bool help = false;
+            std::size_t invalid_utf8 = SIZE_MAX;    //the first token that is not valid UTF-8, if `require_utf8` is on
+            std::size_t occurrences = 0;
+            std::size_t first_occurrence = 0;   //where the chunk's entries start in the occurrence log
+            std::unordered_map<CmdArg*, Tally> tallies;
+            std::vector<std::pair<CmdArg*, std::string_view>> map_entries;
+            std::vector<std::string_view> unknown_args;
+        };
+
+        std::vector<Token> tokens(token_count);
+        std::vector<Chunk> chunks(chunk_count);
+        for (std::size_t c = 0; c < chunk_count; ++c)
+        {
+            chunks[c].begin = token_count * c / chunk_count;
+            chunks[c].end = token_count * (c + 1) / chunk_count;
+        }
+
+        //1. Classify
+        run_in_parallel(chunk_count, [&](std::size_t c)
+        {
+            Chunk& chunk = chunks[c];
+            for (std::size_t i = chunk.begin; i < chunk.end; ++i)
+            {
+                Token& token = tokens[i];
+                token.text = argv[i + 1];
+                std::tie(token.kind, token.arg) = classify_token(token.text);
+
+
+                if (token.kind == TokenKind::Option or token.kind == TokenKind::MapEntry)
+                {
+                    chunk.changes_arg = true;
+                    chunk.last_arg = token.kind == TokenKind::Option ? token.arg : nullptr;
                 }
+
+                //A serial parse stops at whichever of the two comes first
+                if (utf8_required and chunk.invalid_utf8 == SIZE_MAX and not chunk.help and detail::find_invalid_utf8(token.text) != token.text.size())
+                    chunk.invalid_utf8 = i;
+
+                chunk.help |= token.kind == TokenKind::Help and chunk.invalid_utf8 == SIZE_MAX;
             }
-            else if (arg != nullptr)
+        });
+
+        //2. Carry the current option from chunk to chunk
+        for (std::size_t c = 1; c < chunk_count; ++c)
+            chunks[c].first_arg = chunks[c - 1].changes_arg ? chunks[c - 1].last_arg : chunks[c - 1].first_arg;
+
+        for (const Chunk& chunk : chunks)
+        {
+            if (chunk.help)
+                help();
+
+            if (chunk.invalid_utf8 != SIZE_MAX)
+                check_utf8(tokens[chunk.invalid_utf8].text, chunk.invalid_utf8 + 1);
+        }
+
+        //3. Tally
+        run_in_parallel(chunk_count, [&](std::size_t c)
+        {
+            Chunk& chunk = chunks[c];
+            CmdArg* arg = chunk.first_arg;
+
+            for (std::size_t i = chunk.begin; i < chunk.end; ++i)
             {
-                switch (arg->on_parse)
+                const Token& token = tokens[i];
+                switch (token.kind)
                 {
-                    case ArgAction::StoreSingle:
-                        arg->values[0] = cmdarg;
+                    case TokenKind::Option:
+                        arg = token.arg;
+                        chunk.tallies[arg].options++;
+                        chunk.occurrences++;
                         break;
 
-                    case ArgAction::StoreMany:
-                        if (arg->values.size() > 0 and not arg->values[0].empty()) //TODO: refactor this mess
+                    case TokenKind::MapEntry:
+                        arg = nullptr;
+                        chunk.occurrences++;
+                        chunk.map_entries.emplace_back(token.arg, token.text.substr(1 + token.arg->short_name.size()));
+                        break;
+
+                    case TokenKind::Unknown:
+                        chunk.unknown_args.push_back(token.text);
+                        break;
+
+                    case TokenKind::Value:
+                        if (arg == nullptr or not takes_values(arg))
+                            break;
+
+                        chunk.occurrences++;
+                        if (arg->on_parse == ArgAction::StoreMap)
                         {
-                            arg->values.push_back(cmdarg);
+                            chunk.map_entries.emplace_back(arg, token.text);
                         }
                         else
                         {
-                            arg->values[0] = cmdarg;
+                            Tally& tally = chunk.tallies[arg];
+                            tally.values++;
+                            tally.last_value = token.text;
                         }
                         break;
+
+                    default:
+                        break;
                 }
             }
+        });
+
+        //4. Merge, in chunk order
+        std::unordered_map<CmdArg*, std::size_t> store_many_sizes;
+        std::size_t occurrence_count = 0;
+        ParseState state;
+
+        for (Chunk& chunk : chunks)
+        {
+            chunk.first_occurrence = occurrence_count;
+            occurrence_count += chunk.occurrences;
+
+            for (auto& [arg, tally] : chunk.tallies)
+            {
+                if (tally.options > 0)
+                {
+                    apply_option(arg);
+                    if (arg->on_parse == ArgAction::Count)
+                        arg->count += tally.options - 1;
+                }
+
+                if (tally.values == 0)
+                    continue;
+
+                if (arg->on_parse == ArgAction::StoreSingle)
+                {
+                    apply_value(arg, tally.last_value);
+                }
+                else
+                {
+                    auto [size, _] = store_many_sizes.try_emplace(arg, arg->values.size());
+                    tally.next_slot = size->second;
+                    size->second += tally.values;
+                }
+            }
+
+            for (const auto& [arg, entry] : chunk.map_entries)
+            {
+                arg->set = true;
+                arg->entries.insert(entry, arg->duplicate_keys == MapPolicy::LastWins);
+            }
+
+            state.unknown_args.insert(state.unknown_args.end(), chunk.unknown_args.begin(), chunk.unknown_args.end());
         }
 
+        for (const auto& [arg, size] : store_many_sizes)
+            arg->values.resize(size);
+
+        occurrence_log.resize(occurrence_count);
+
+        //5. Fill each chunk's StoreMany slices and occurrence log entries
+        run_in_parallel(chunk_count, [&](std::size_t c)
+        {
+            Chunk& chunk = chunks[c];
+            CmdArg* arg = chunk.first_arg;
+            Tally* tally = nullptr;
+            Occurrence* occurrence = occurrence_log.data() + chunk.first_occurrence;
+
+            for (std::size_t i = chunk.begin; i < chunk.end; ++i)
+            {
+                const Token& token = tokens[i];
+                if (token.kind == TokenKind::Option)
+                {
+                    arg = token.arg;
+                    tally = nullptr;
+                    *occurrence++ = {arg, std::string_view(), i + 1, true};
+                }
+                else if (token.kind == TokenKind::MapEntry)
+                {
+                    arg = nullptr;
+                    tally = nullptr;
+                    *occurrence++ = {token.arg, token.text.substr(1 + token.arg->short_name.size()), i + 1, false};
+                }
+                else if (token.kind == TokenKind::Value and arg != nullptr and takes_values(arg))
+                {
+                    *occurrence++ = {arg, token.text, i + 1, false};
+                    if (arg->on_parse != ArgAction::StoreMany)
+                        continue;
+
+                    if (tally == nullptr)
+                        tally = &chunk.tallies[arg];
+
+                    arg->values[tally->next_slot++] = token.text;
+                }
+            }
+        });
+
+        validate_known_args(state.unknown_args);
         validate_required_args();
+        validate_values();
+    }
+
+    //Runs task(0) ... task(task_count - 1) on as many threads
+    template <typename Function>
+    void Parser::run_in_parallel(std::size_t task_count, const Function& task)
+    {
+        std::vector<std::thread> pool;
+        for (std::size_t i = 1; i < task_count; ++i)
+            pool.emplace_back(task, i);
+
+        task(0);
+        for (std::thread& thread : pool)
+            thread.join();
+    }
+
+    //The `StoreMap` argument whose abbreviation `cmdarg` starts with, as in "-Dkey=value", if any
+    CmdArg* Parser::find_attached_map_arg(std::string_view cmdarg) const
+    {
+        if (cmdarg.size() < 3 or cmdarg[0] != '-' or cmdarg[1] == '-')
+            return nullptr;
+
+        for (CmdArg* arg : map_arguments)
+        {
+            if (cmdarg.size() > 1 + arg->short_name.size() and cmdarg.substr(1, arg->short_name.size()) == arg->short_name)
+                return arg;
+        }
+
+        return nullptr;
+    }
+
+    /*
+        Reports every option that was not recognized, together with the closest known names, e.g.
+        "the following arguments were not recognized: --theads (did you mean --threads?)"
+    */
+    void Parser::validate_known_args(const std::vector<std::string_view>& unknown_args) const
+    {
+        if (unknown_args.empty())
+            return;
+
+        if (long_name_suggestions.empty())
+        {
+            for (const auto& [name, _] : argument_aliases)
+                long_name_suggestions.add(name);
+
+            for (const auto& [name, _] : argument_abbreviations)
+                short_name_suggestions.add(name);
+        }
+
+        std::string argument_errors;
+        for (std::string_view unknown : unknown_args)
+        {
+            if (not argument_errors.empty())
+                argument_errors += ", ";
+
+            argument_errors.append(unknown);
+
+            //"--theads" is compared against long names only; "-theads" could be either
+            bool is_long = unknown.substr(0, 2) == "--";
+            std::string_view name = unknown.substr(is_long ? 2 : 1);
+            std::vector<std::tuple<std::size_t, std::string_view, std::string_view>> suggestions;
+
+            for (const auto& [distance, suggestion] : long_name_suggestions.closest(name, 3))
+                suggestions.emplace_back(distance, "--", suggestion);
+
+            if (not is_long)
+            {
+                for (const auto& [distance, suggestion] : short_name_suggestions.closest(name, 3))
+                    suggestions.emplace_back(distance, "-", suggestion);
+            }
+
+            std::sort(suggestions.begin(), suggestions.end());
+            for (std::size_t i = 0; i < suggestions.size() and i < 3; ++i)
+                argument_errors.append(i == 0 ? " (did you mean " : " or ").append(std::get<1>(suggestions[i])).append(std::get<2>(suggestions[i]));
+
+            if (not suggestions.empty())
+                argument_errors += "?)";
+        }
+
+        throw std::runtime_error("the following arguments were not recognized: " + argument_errors);
     }
 
     void Parser::validate_required_args() const
@@ -152,7 +857,7 @@ namespace carp
                 if (not argument_errors.empty())
                     argument_errors += ", ";
 
-                argument_errors += cmdarg->long_name + " (" + cmdarg->short_name + ")";
+                argument_errors.append("--").append(cmdarg->long_name).append(" (-").append(cmdarg->short_name).append(")");
             }
         }
 
@@ -162,44 +867,271 @@ namespace carp
         }
     }
 
-    const std::shared_ptr<CmdArg> Parser::get_arg(std::string name) const
+    /*
+        Runs the validators of every provided argument against each of its values, which for a `StoreMap` argument
+        are the values of its entries (the "value" of "-D key=value"). The checks run concurrently on a small pool
+        of threads, so the total wait is bounded by the slowest check (given enough threads) rather than the sum
+        of all of them. Patterns are matched first, on this thread, since a DFA walk is far
+        cheaper than starting a thread; a value that does not match is not handed to the validators at all.
+        Answers that pure validators already know are taken from their caches, and threads are only started
+        when at least two checks are left to run, so parsing again, or with a single slow validator, starts none.
+        Every failure is collected into a single error.
+    */
+    void Parser::validate_values() const
+    {
+        struct Check
+        {
+            const CmdArg* arg;
+            Validator* validator;       //nullptr once the answer is known: a cached one, or a value that failed the pattern
+            const std::string* value;
+            std::optional<std::string_view> key;    //the key of a map entry, shown with its value when the check fails
+            bool passed;
+        };
+
+        std::vector<Check> checks;
+        std::list<std::string> map_values;      //copies of map entry values for the validators, which take strings
+        std::size_t pending = 0;
+
+        auto add_checks = [&](const CmdArg* cmdarg, const std::string& value, std::optional<std::string_view> key)
+        {
+            if (cmdarg->value_pattern and not cmdarg->value_pattern->matches(value))
+            {
+                checks.push_back({cmdarg, nullptr, &value, key, false});
+                return;
+            }
+
+            for (const std::shared_ptr<Validator>& validator : cmdarg->validators)
+            {
+                if (std::optional<bool> known = validator->cached(value))
+                {
+                    checks.push_back({cmdarg, nullptr, &value, key, *known});
+                    continue;
+                }
+
+                checks.push_back({cmdarg, validator.get(), &value, key, false});
+                pending++;
+            }
+        };
+
+        for (const auto& [_, cmdarg] : arguments)
+        {
+            if (not cmdarg->set)
+                continue;
+
+            for (const std::string& value : cmdarg->values)
+                add_checks(cmdarg.get(), value, std::nullopt);
+
+            if (cmdarg->value_pattern or not cmdarg->validators.empty())
+            {
+                cmdarg->entries.for_each([&](std::string_view key, std::string_view value)
+                {
+                    add_checks(cmdarg.get(), map_values.emplace_back(value), key);
+                });
+            }
+        }
+
+        std::atomic<std::size_t> next_check {0};
+        auto worker = [&]()
+        {
+            for (std::size_t i = next_check++; i < checks.size(); i = next_check++)
+            {
+                if (checks[i].validator != nullptr)
+                    checks[i].passed = checks[i].validator->check(*checks[i].value);
+            }
+        };
+
+        //Validators are usually waiting on the filesystem or the network, so use more threads than cores
+        std::size_t thread_limit = validation_thread_limit != 0 ? validation_thread_limit : std::max(4u, 2 * std::thread::hardware_concurrency());
+        std::size_t thread_count = std::min(pending, thread_limit);
+
+        if (thread_count > 1)
+        {
+            std::vector<std::thread> pool;
+            for (std::size_t i = 1; i < thread_count; ++i)
+                pool.emplace_back(worker);
+
+            worker();
+            for (std::thread& thread : pool)
+                thread.join();
+        }
+        else
+        {
+            worker();
+        }
+
+        std::string argument_errors;
+        for (const Check& check : checks)
+        {
+            if (check.passed)
+                continue;
+
+            if (not argument_errors.empty())
+                argument_errors += ", ";
+
+            argument_errors.append("--").append(check.arg->long_name).append(" ('");
+            if (check.key)
+                argument_errors.append(*check.key).append("=");
+
+            argument_errors.append(*check.value).append("')");
+        }
+
+        if (not argument_errors.empty())
+        {
+            throw std::runtime_error("the following arguments failed validation: " + argument_errors);
+        }
+    }
+
+    //Looks `name` up as an identifier, then as "--<long name>" or "-<short name>"; nullptr if nothing matches
+    const std::shared_ptr<CmdArg>* Parser::find_arg(std::string_view name) const
     {
-        if (arguments.find(name) != arguments.end())
-            return arguments.at(name);
+        if (auto it = arguments.find(name); it != arguments.end())
+            return &it->second;
+
+        if (name.substr(0, 2) == "--")
+        {
+            auto it = argument_aliases.find(name.substr(2));
+            return it != argument_aliases.end() ? &it->second : nullptr;
+        }
+
+        if (name.substr(0, 1) == "-")
+        {
+            auto it = argument_abbreviations.find(name.substr(1));
+            return it != argument_abbreviations.end() ? &it->second : nullptr;
+        }
 
-        return argument_aliases.at(name);
+        return nullptr;
     }
 
-    const bool Parser::arg_exists(std::string name) const
+    const std::shared_ptr<CmdArg> Parser::get_arg(std::string_view name) const
     {
-        return arguments.find(name) != arguments.end() or argument_aliases.find(name) != argument_aliases.end();
+        if (const std::shared_ptr<CmdArg>* arg = find_arg(name))
+            return *arg;
+
+        throw std::out_of_range("no argument named '" + std::string(name) + "'");
     }
 
-    void Parser::help() const
+    //Shorthand for `get_arg(name)->get_map_value(key)`
+    std::optional<std::string_view> Parser::get_map_value(std::string_view name, std::string_view key) const
     {
-        program_info.details();
+        return get_arg(name)->get_map_value(key);
+    }
 
-        for(const auto& [_, cmdarg] : arguments)
+    /*
+        Every option and stored value of the last parse, in command-line order, e.g. to apply --include and --exclude
+        filters in the order they were given, or to visit only the arguments that were actually set.
+    */
+    const std::vector<Occurrence>& Parser::occurrences() const
+    {
+        return occurrence_log;
+    }
+
+    /*
+        A read-only copy of every argument as it is now, for worker threads to read without any synchronization
+        (see frozen-args.hh). Names resolve exactly as they do with `get_arg`.
+    */
+    FrozenArgs Parser::freeze() const
+    {
+        FrozenArgs frozen;
+        frozen.args.reserve(arguments.size());
+
+        //Identifiers go first, since `find_arg` tries them before long and short names
+        std::unordered_map<const CmdArg*, std::uint32_t> indices;
+        auto add_names = [&](const std::unordered_map<std::string_view, std::shared_ptr<CmdArg>>& table, std::string_view prefix)
         {
-            std::cout << cmdarg->summary() << '\n';
+            for (const auto& [name, arg] : table)
+            {
+                auto [index, inserted] = indices.try_emplace(arg.get(), static_cast<std::uint32_t>(frozen.args.size()));
+                if (inserted)
+                    frozen.args.push_back({*arg});
+
+                frozen.add_name(prefix, name, index->second);
+            }
+        };
+
+        add_names(arguments, "");
+        add_names(argument_aliases, "--");
+        add_names(argument_abbreviations, "-");
+        frozen.build_table();
+
+        return frozen;
+    }
+
+    /*
+        Every argument whose long name is `path` or lies under it: "db.pool" gives "--db.pool.size" and "--db.pool.timeout",
+        "db" also gives "--db.user", and "" gives all arguments. The result is a view that stays valid until arguments
+        are added or removed.
+    */
+    ArgumentSubtree Parser::get_namespace(std::string_view path) const
+    {
+        return namespaces().find(path);
+    }
+
+    const detail::NamespaceTree& Parser::namespaces() const
+    {
+        if (namespace_tree.empty())
+        {
+            std::vector<const CmdArg*> all;
+            all.reserve(arguments.size());
+
+            for (const auto& [_, cmdarg] : arguments)
+                all.push_back(cmdarg.get());
+
+            namespace_tree.build(std::move(all));
         }
+
+        return namespace_tree;
+    }
+
+    const bool Parser::arg_exists(std::string_view name) const
+    {
+        return find_arg(name) != nullptr;
+    }
+
+    /*
+        Prints the help screen to standard output in a single write, after whatever stdout has buffered, then exits.
+        A program that called std::ios::sync_with_stdio(false) has to flush std::cout itself before calling this.
+    */
+    void Parser::help() const
+    {
+        write_help(1);
         exit(1);
     }
 
+    //Formats the help screen into `buffer`; like snprintf, returns the size the whole screen needs, which may be larger than `size`
+    std::size_t Parser::format_help(char* buffer, std::size_t size) const
+    {
+        Writer writer(buffer, size);
+        format_help(writer);
+        return writer.required();
+    }
+
+    //Writes the help screen to a file descriptor in a single write, after what stdout or stderr has buffered for it; false if the write failed
+    bool Parser::write_help(int fd) const
+    {
+        return detail::write_formatted(fd, [this](Writer& out) { format_help(out); });
+    }
+
+    void Parser::format_help(Writer& out) const
+    {
+        program_info.details(out);
+        namespaces().format(out);
+    }
+
     #ifdef CARP_DEBUG
         void Parser::print_all_arguments() const
         {
-            std::cout << std::boolalpha;
-            for(const auto& [_, cmdarg] : arguments)
+            detail::write_formatted(1, [this](Writer& out)
             {
-                std::cout << "Identifier: " << cmdarg->identifier << '\n'
-                            << "Long name: " << cmdarg->long_name << '\n'
-                            << "Short name: " << cmdarg->short_name << '\n'
-                            << "Description: " << cmdarg->description << '\n'
-                            << "Required?: " << cmdarg->enforced << '\n'
-                            << "Set?: " << cmdarg->set << "\n\n";
-            }
+                for(const auto& [_, cmdarg] : arguments)
+                {
+                    out.append("Identifier: ").append(cmdarg->identifier).append('\n')
+                       .append("Long name: --").append(cmdarg->long_name).append('\n')
+                       .append("Short name: -").append(cmdarg->short_name).append('\n')
+                       .append("Description: ").append(cmdarg->description).append('\n')
+                       .append("Required?: ").append(cmdarg->enforced ? "true" : "false").append('\n')
+                       .append("Set?: ").append(cmdarg->set ? "true" : "false").append("\n\n");
+                }
+            });
         }
     #endif
 }
-
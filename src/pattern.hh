@@ -0,0 +1,573 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <map>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+    Value patterns for `CmdArg::pattern`, e.g. "[a-z0-9-]+(\.[a-z0-9-]+)*:[0-9]{1,5}" for "host:port".
+
+    A pattern is compiled once, when the argument is defined: parsed into a syntax tree, turned into a Thompson
+    NFA, and the NFA into a DFA by subset construction. Matching a value is then one table lookup per byte, with
+    no recursion and no backtracking, so it takes O(n) time and constant stack on any input, unlike std::regex.
+    As with std::regex_match, the whole value has to match.
+
+    Supported: literals, '.' (any byte, newlines included), [classes] with ranges and '^', \d \w \s \D \W \S, escaped
+    metacharacters, (groups), alternation '|', and the quantifiers * + ? {m} {m,} {m,n}. Patterns work on bytes, so
+    a non-ASCII character is a sequence of literals and cannot be part of a range. There are no backreferences or
+    lookarounds, which no DFA can express. A pattern whose DFA would need more than `max_states` states is rejected.
+
+    K. Thompson, "Programming Techniques: Regular expression search algorithm" (1968)
+    R. Cox, "Regular Expression Matching Can Be Simple And Fast" (2007): https://swtch.com/~rsc/regexp/regexp1.html
+*/
+
+namespace carp
+{
+    class Pattern final
+    {
+        public:
+            static constexpr std::size_t max_states = 4096;             //DFA states
+            static constexpr std::size_t max_nfa_states = 1 << 16;
+            static constexpr std::uint32_t max_repeat = 1000;           //the largest bound of a {m,n}
+
+            Pattern(std::string_view);
+
+            bool matches(std::string_view) const;
+            std::string_view source() const;
+            std::size_t state_count() const;
+
+        private:
+            std::string text;
+            std::array<std::uint16_t, 256> byte_class;          //bytes that no part of the pattern tells apart share a class
+            std::size_t class_count;
+            std::vector<std::uint32_t> transitions;             //[row + class], where a state's row is its index * class_count; 0 is the dead state
+            std::vector<std::uint8_t> accepting;
+            std::uint32_t start;                                //a row, like every entry of `transitions`
+    };
+
+    namespace detail
+    {
+        class PatternCompiler final
+        {
+            public:
+                PatternCompiler(std::string_view);
+
+                void compile(std::array<std::uint16_t, 256>&, std::size_t&, std::vector<std::uint32_t>&, std::vector<std::uint8_t>&, std::uint32_t&);
+
+            private:
+                static constexpr std::uint32_t none = UINT32_MAX;
+                using ByteSet = std::bitset<256>;
+
+                struct Node
+                {
+                    enum class Kind { Empty, Bytes, Concat, Alternate, Repeat } kind;
+                    std::uint32_t set = none;       //Bytes: index into `sets`
+                    std::uint32_t left = none;      //Concat, Alternate; the repeated node for Repeat
+                    std::uint32_t right = none;     //Concat, Alternate
+                    std::uint32_t min = 0;          //Repeat; `none` as the maximum means unbounded
+                    std::uint32_t max = 0;
+                };
+
+                struct NfaState
+                {
+                    std::uint32_t set = none;       //consumes one byte of `sets[set]` and moves to `next`
+                    std::uint32_t next = none;
+                    std::vector<std::uint32_t> epsilon;
+                };
+
+                [[noreturn]] void fail(std::string_view) const;
+                bool at_end() const;
+                char peek() const;
+
+                std::uint32_t add_node(Node);
+                std::uint32_t add_set(const ByteSet&);
+                std::uint32_t parse_alternation();
+                std::uint32_t parse_concatenation();
+                std::uint32_t parse_repetition();
+                std::uint32_t parse_atom();
+                std::uint32_t parse_count();
+                ByteSet parse_class();
+                int parse_escape(ByteSet&);
+
+                std::uint32_t add_state();
+                std::uint32_t fresh_state(std::uint32_t);
+                std::uint32_t build_nfa(std::uint32_t, std::uint32_t);
+                void close(std::vector<std::uint32_t>&) const;
+
+                std::string_view pattern;
+                std::size_t position = 0;
+                std::vector<Node> nodes;
+                std::vector<ByteSet> sets;
+                std::vector<NfaState> states;
+        };
+
+        PatternCompiler::PatternCompiler(std::string_view source)
+        {
+            pattern = source;
+        }
+
+        void PatternCompiler::fail(std::string_view reason) const
+        {
+            throw std::runtime_error("invalid pattern '" + std::string(pattern) + "': " + std::string(reason) + " at offset " + std::to_string(position));
+        }
+
+        bool PatternCompiler::at_end() const
+        {
+            return position == pattern.size();
+        }
+
+        char PatternCompiler::peek() const
+        {
+            return at_end() ? '\0' : pattern[position];
+        }
+
+        std::uint32_t PatternCompiler::add_node(Node node)
+        {
+            nodes.push_back(node);
+            return static_cast<std::uint32_t>(nodes.size() - 1);
+        }
+
+        std::uint32_t PatternCompiler::add_set(const ByteSet& set)
+        {
+            sets.push_back(set);
+            return add_node({Node::Kind::Bytes, static_cast<std::uint32_t>(sets.size() - 1)});
+        }
+
+        //alternation := concatenation ('|' concatenation)*
+        std::uint32_t PatternCompiler::parse_alternation()
+        {
+            std::uint32_t node = parse_concatenation();
+            while (peek() == '|')
+            {
+                ++position;
+                node = add_node({Node::Kind::Alternate, none, node, parse_concatenation()});
+            }
+
+            return node;
+        }
+
+        //concatenation := repetition*
+        std::uint32_t PatternCompiler::parse_concatenation()
+        {
+            std::uint32_t node = add_node({Node::Kind::Empty});
+            while (not at_end() and peek() != '|' and peek() != ')')
+                node = add_node({Node::Kind::Concat, none, node, parse_repetition()});
+
+            return node;
+        }
+
+        //repetition := atom ('*' | '+' | '?' | '{' m [',' [n]] '}')*
+        std::uint32_t PatternCompiler::parse_repetition()
+        {
+            std::uint32_t node = parse_atom();
+            while (not at_end())
+            {
+                Node repeat {Node::Kind::Repeat, none, node};
+
+                switch (peek())
+                {
+                    case '*': repeat.min = 0; repeat.max = none; break;
+                    case '+': repeat.min = 1; repeat.max = none; break;
+                    case '?': repeat.min = 0; repeat.max = 1; break;
+
+                    case '{':
+                        ++position;
+                        repeat.min = parse_count();
+                        repeat.max = repeat.min;
+
+                        if (peek() == ',')
+                        {
+                            ++position;
+                            repeat.max = peek() == '}' ? none : parse_count();
+                        }
+
+                        if (peek() != '}')
+                            fail("expected '}'");
+
+                        if (repeat.max < repeat.min)
+                            fail("repetition bounds out of order");
+                        break;
+
+                    default:
+                        return node;
+                }
+
+                ++position;
+                node = add_node(repeat);
+            }
+
+            return node;
+        }
+
+        std::uint32_t PatternCompiler::parse_count()
+        {
+            std::uint32_t count = 0;
+            std::size_t digits = 0;
+
+            for (; peek() >= '0' and peek() <= '9'; ++position, ++digits)
+            {
+                count = count * 10 + (peek() - '0');
+                if (count > Pattern::max_repeat)
+                    fail("repetition count above " + std::to_string(Pattern::max_repeat));
+            }
+
+            if (digits == 0)
+                fail("expected a repetition count");
+
+            return count;
+        }
+
+        //atom := '(' alternation ')' | '[' class ']' | '.' | '\' escape | literal
+        std::uint32_t PatternCompiler::parse_atom()
+        {
+            if (at_end())
+                fail("unexpected end");
+
+            char c = pattern[position++];
+            ByteSet set;
+
+            switch (c)
+            {
+                case '(':
+                {
+                    std::uint32_t group = parse_alternation();
+                    if (peek() != ')')
+                        fail("unbalanced '('");
+
+                    ++position;
+                    return group;
+                }
+
+                case '[':
+                    return add_set(parse_class());
+
+                case '.':
+                    return add_set(set.set());
+
+                case '\\':
+                    parse_escape(set);
+                    return add_set(set);
+
+                case '*': case '+': case '?': case '{':
+                    --position;
+                    fail("nothing to repeat");
+
+                default:
+                    return add_set(set.set(static_cast<unsigned char>(c)));
+            }
+        }
+
+        //Adds the bytes of the escape after a '\' to `set`; returns the byte if it stands for a single one, which may start a range, or -1
+        int PatternCompiler::parse_escape(ByteSet& set)
+        {
+            if (at_end())
+                fail("pattern ends with '\\'");
+
+            char c = pattern[position++];
+            ByteSet shorthand;
+
+            switch (c)
+            {
+                case 'd': case 'D':
+                    for (char digit = '0'; digit <= '9'; ++digit)
+                        shorthand.set(static_cast<unsigned char>(digit));
+                    break;
+
+                case 'w': case 'W':
+                    for (int byte = 0; byte < 256; ++byte)
+                        shorthand[byte] = (byte >= 'a' and byte <= 'z') or (byte >= 'A' and byte <= 'Z') or (byte >= '0' and byte <= '9') or byte == '_';
+                    break;
+
+                case 's': case 'S':
+                    for (char space : { ' ', '\t', '\n', '\r', '\f', '\v' })
+                        shorthand.set(static_cast<unsigned char>(space));
+                    break;
+
+                case 'n': set.set('\n'); return '\n';
+                case 't': set.set('\t'); return '\t';
+                case 'r': set.set('\r'); return '\r';
+
+                default:
+                    if ((c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or (c >= '0' and c <= '9'))
+                    {
+                        --position;
+                        fail("unknown escape");
+                    }
+
+                    set.set(static_cast<unsigned char>(c));
+                    return static_cast<unsigned char>(c);
+            }
+
+            set |= (c >= 'A' and c <= 'Z') ? ~shorthand : shorthand;
+            return -1;
+        }
+
+        //class := '^'? (byte ('-' byte)? | escape)+ ']', where a ']' right after the '[' (or '[^') is a literal
+        PatternCompiler::ByteSet PatternCompiler::parse_class()
+        {
+            ByteSet set;
+            bool negated = peek() == '^';
+            position += negated;
+
+            for (bool first = true; first or peek() != ']'; first = false)
+            {
+                if (at_end())
+                    fail("unbalanced '['");
+
+                ByteSet item;
+                int low = static_cast<unsigned char>(pattern[position]);
+
+                if (pattern[position++] == '\\')
+                    low = parse_escape(item);
+                else
+                    item.set(low);
+
+                //"a-z"; a '-' right before the ']' is a literal
+                if (low >= 0 and peek() == '-' and position + 1 < pattern.size() and pattern[position + 1] != ']')
+                {
+                    ++position;
+                    int high = static_cast<unsigned char>(pattern[position++]);
+                    if (high == '\\')
+                        fail("escapes cannot end a range");
+
+                    if (high < low)
+                        fail("range out of order");
+
+                    for (int byte = low; byte <= high; ++byte)
+                        item.set(byte);
+                }
+
+                set |= item;
+            }
+
+            ++position;
+            return negated ? ~set : set;
+        }
+
+        std::uint32_t PatternCompiler::add_state()
+        {
+            if (states.size() == Pattern::max_nfa_states)
+                fail("pattern is too large");
+
+            states.emplace_back();
+            return static_cast<std::uint32_t>(states.size() - 1);
+        }
+
+        //A new state that `from` reaches without consuming anything
+        std::uint32_t PatternCompiler::fresh_state(std::uint32_t from)
+        {
+            std::uint32_t state = add_state();
+            states[from].epsilon.push_back(state);
+            return state;
+        }
+
+        /*
+            Thompson's construction: adds the states for `nodes[index]` after `from` and returns the state it ends in.
+            Every piece starts from a state of its own, so that no loop or choice leaks into what comes before it.
+        */
+        std::uint32_t PatternCompiler::build_nfa(std::uint32_t index, std::uint32_t from)
+        {
+            const Node node = nodes[index];
+            std::uint32_t entry = fresh_state(from);
+
+            switch (node.kind)
+            {
+                case Node::Kind::Empty:
+                    return entry;
+
+                case Node::Kind::Bytes:
+                {
+                    std::uint32_t exit = add_state();
+                    states[entry].set = node.set;
+                    states[entry].next = exit;
+                    return exit;
+                }
+
+                case Node::Kind::Concat:
+                    return build_nfa(node.right, build_nfa(node.left, entry));
+
+                case Node::Kind::Alternate:
+                {
+                    std::uint32_t exit = add_state();
+                    states[build_nfa(node.left, entry)].epsilon.push_back(exit);
+                    states[build_nfa(node.right, entry)].epsilon.push_back(exit);
+                    return exit;
+                }
+
+                case Node::Kind::Repeat:
+                {
+                    std::uint32_t current = entry;
+                    for (std::uint32_t i = 0; i < node.min; ++i)
+                        current = build_nfa(node.left, current);
+
+                    //x*: a loop through a state of its own, which is also the way out
+                    if (node.max == none)
+                    {
+                        std::uint32_t loop = fresh_state(current);
+                        states[build_nfa(node.left, loop)].epsilon.push_back(loop);
+                        return loop;
+                    }
+
+                    //x{0,k}: k optional copies, each of which may be skipped
+                    std::uint32_t exit = add_state();
+                    for (std::uint32_t i = node.min; i < node.max; ++i)
+                    {
+                        states[current].epsilon.push_back(exit);
+                        current = build_nfa(node.left, current);
+                    }
+
+                    states[current].epsilon.push_back(exit);
+                    return exit;
+                }
+            }
+
+            return entry;
+        }
+
+        //Extends a set of NFA states with every state reachable without consuming input, then keeps only the states that matter
+        void PatternCompiler::close(std::vector<std::uint32_t>& set) const
+        {
+            std::vector<bool> seen(states.size());
+            std::vector<std::uint32_t> pending(set);
+            set.clear();
+
+            while (not pending.empty())
+            {
+                std::uint32_t state = pending.back();
+                pending.pop_back();
+
+                if (seen[state])
+                    continue;
+
+                seen[state] = true;
+                for (std::uint32_t next : states[state].epsilon)
+                    pending.push_back(next);
+
+                //Only states that consume a byte, and the final state, tell two DFA states apart
+                if (states[state].set != none or state == states.size() - 1)
+                    set.push_back(state);
+            }
+
+            std::sort(set.begin(), set.end());
+        }
+
+        void PatternCompiler::compile(std::array<std::uint16_t, 256>& byte_class, std::size_t& class_count, std::vector<std::uint32_t>& transitions,
+                                      std::vector<std::uint8_t>& accepting, std::uint32_t& start)
+        {
+            std::uint32_t root = parse_alternation();
+            if (not at_end())
+                fail("unbalanced ')'");
+
+            //The last state added is the one and only final state
+            std::uint32_t initial = add_state();
+            fresh_state(build_nfa(root, initial));
+
+            //Bytes that belong to exactly the same sets behave the same everywhere
+            std::map<std::vector<bool>, std::uint16_t> classes;
+            std::vector<unsigned char> representative;
+
+            for (int byte = 0; byte < 256; ++byte)
+            {
+                std::vector<bool> membership(sets.size());
+                for (std::size_t i = 0; i < sets.size(); ++i)
+                    membership[i] = sets[i][byte];
+
+                auto [entry, inserted] = classes.try_emplace(membership, static_cast<std::uint16_t>(classes.size()));
+                if (inserted)
+                    representative.push_back(static_cast<unsigned char>(byte));
+
+                byte_class[byte] = entry->second;
+            }
+
+            class_count = classes.size();
+
+            //Subset construction; DFA state 0 is the empty set, i.e. the dead state
+            std::map<std::vector<std::uint32_t>, std::uint32_t> dfa_states;
+            std::vector<std::vector<std::uint32_t>> subsets;
+
+            auto find_or_add = [&](std::vector<std::uint32_t>& subset)
+            {
+                auto [entry, inserted] = dfa_states.try_emplace(subset, static_cast<std::uint32_t>(subsets.size()));
+                if (inserted)
+                {
+                    if (subsets.size() == Pattern::max_states)
+                        fail("pattern needs more than " + std::to_string(Pattern::max_states) + " DFA states");
+
+                    subsets.push_back(subset);
+                    transitions.resize(transitions.size() + class_count, 0);
+                    accepting.push_back(not subset.empty() and subset.back() == states.size() - 1);
+                }
+
+                return entry->second;
+            };
+
+            std::vector<std::uint32_t> subset;
+            find_or_add(subset);
+
+            subset.push_back(initial);
+            close(subset);
+            start = find_or_add(subset);
+
+            for (std::uint32_t dfa_state = 1; dfa_state < subsets.size(); ++dfa_state)
+            {
+                for (std::size_t byte_class_index = 0; byte_class_index < class_count; ++byte_class_index)
+                {
+                    subset.clear();
+                    for (std::uint32_t state : subsets[dfa_state])
+                    {
+                        const NfaState& nfa_state = states[state];
+                        if (nfa_state.set != none and sets[nfa_state.set][representative[byte_class_index]])
+                            subset.push_back(nfa_state.next);
+                    }
+
+                    close(subset);
+                    std::uint32_t next = find_or_add(subset);
+                    transitions[dfa_state * class_count + byte_class_index] = next;
+                }
+            }
+
+            //Store rows rather than states, which saves matching a multiplication per byte
+            for (std::uint32_t& next : transitions)
+                next *= static_cast<std::uint32_t>(class_count);
+
+            start *= static_cast<std::uint32_t>(class_count);
+        }
+    }
+
+    //Compiles `source`; throws std::runtime_error if it is not a valid pattern or is too large
+    Pattern::Pattern(std::string_view source)
+    {
+        text = source;
+        detail::PatternCompiler(text).compile(byte_class, class_count, transitions, accepting, start);
+    }
+
+    //Whether all of `value` matches, in one pass over it
+    bool Pattern::matches(std::string_view value) const
+    {
+        std::uint32_t state = start;
+        for (char c : value)
+        {
+            state = transitions[state + byte_class[static_cast<unsigned char>(c)]];
+            if (state == 0)
+                return false;
+        }
+
+        return accepting[state / class_count];
+    }
+
+    std::string_view Pattern::source() const
+    {
+        return text;
+    }
+
+    std::size_t Pattern::state_count() const
+    {
+        return accepting.size();
+    }
+}
@@ -1,9 +1,10 @@
 #pragma once
 
-#include <iostream>
 #include <string>
 #include <optional>
 
+#include "writer.hh"
+
 /*
     <program_name> <version> [by <author>] [, <license> license]
     <description>
@@ -22,6 +23,7 @@ namespace carp
         ProgramInfo(std::optional<std::string>, std::optional<std::string>, std::optional<std::string>, std::optional<std::string>, std::optional<std::string>);
 
         void details() const;
+        void details(Writer&) const;
     };
 
     ProgramInfo::ProgramInfo(std::optional<std::string> _author = std::nullopt, std::optional<std::string> _version = std::nullopt, std::optional<std::string> _program_name = std::nullopt, std::optional<std::string> _description = std::nullopt, std::optional<std::string> _license = std::nullopt)
@@ -33,14 +35,20 @@ namespace carp
         license = _license;
     }
 
+    //Prints the details to standard output
     void ProgramInfo::details() const
     {
-        if (program_name) std::cout << program_name.value() << ' ';
-        if (version) std::cout << version.value() << ' ';
+        detail::write_formatted(1, [this](Writer& out) { details(out); });
+    }
+
+    void ProgramInfo::details(Writer& out) const
+    {
+        if (program_name) out.append(program_name.value()).append(' ');
+        if (version) out.append(version.value()).append(' ');
 
-        if (author) std::cout << "by " << author.value();
-        if (license) std::cout << ", " << license.value() << " license";
+        if (author) out.append("by ").append(author.value());
+        if (license) out.append(", ").append(license.value()).append(" license");
 
-        if (description) std::cout << '\n' << description.value() << "\n\n";
+        if (description) out.append('\n').append(description.value()).append("\n\n");
     }
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+
+/*
+    "Did you mean ...?" suggestions for unknown options.
+
+    Distances are computed with Myers' bit-parallel edit distance algorithm, in Hyyrö's formulation for the
+    (global) Levenshtein distance: the whole DP column for a pattern of up to 64 characters lives in two
+    64-bit words, so comparing against a candidate costs a handful of word operations per character.
+    Candidates are bucketed by length, and since the edit distance is at least the difference in length,
+    only the buckets within the distance limit of the unknown name are ever looked at.
+
+    G. Myers, "A fast bit-vector algorithm for approximate string matching based on dynamic programming" (1999)
+    H. Hyyrö, "Explaining and extending the bit-parallel approximate string matching algorithm of Myers" (2001)
+*/
+
+namespace carp
+{
+    namespace detail
+    {
+        class EditDistance final
+        {
+            public:
+                static constexpr std::size_t max_pattern_length = 64;
+
+                EditDistance(std::string_view);
+
+                std::size_t distance(std::string_view, std::size_t) const;
+
+            private:
+                std::array<std::uint64_t, 256> peq {};  //bit i of peq[c] is set when pattern[i] == c
+                std::size_t pattern_length;
+        };
+
+        class Suggestions final
+        {
+            public:
+                void add(std::string_view);
+                void clear();
+                bool empty() const;
+
+                std::vector<std::pair<std::size_t, std::string_view>> closest(std::string_view, std::size_t) const;
+
+            private:
+                std::vector<std::vector<std::string_view>> names_by_length;
+        };
+
+        //The pattern must be at most `max_pattern_length` characters long
+        EditDistance::EditDistance(std::string_view pattern)
+        {
+            pattern_length = pattern.length();
+
+            for (std::size_t i = 0; i < pattern_length; ++i)
+                peq[static_cast<unsigned char>(pattern[i])] |= std::uint64_t{1} << i;
+        }
+
+        //Exact up to `limit`; anything further away is reported as `limit + 1` as soon as that is certain
+        std::size_t EditDistance::distance(std::string_view text, std::size_t limit = SIZE_MAX - 1) const
+        {
+            if (pattern_length == 0)
+                return std::min(text.length(), limit + 1);
+
+            const std::uint64_t last_row = std::uint64_t{1} << (pattern_length - 1);
+            std::uint64_t positive_vertical = ~std::uint64_t{0};
+            std::uint64_t negative_vertical = 0;
+            std::size_t score = pattern_length;
+
+            for (std::size_t i = 0; i < text.length(); ++i)
+            {
+                std::uint64_t eq = peq[static_cast<unsigned char>(text[i])];
+                std::uint64_t x_vertical = eq | negative_vertical;
+                std::uint64_t x_horizontal = (((eq & positive_vertical) + positive_vertical) ^ positive_vertical) | eq;
+
+                std::uint64_t positive_horizontal = negative_vertical | ~(x_horizontal | positive_vertical);
+                std::uint64_t negative_horizontal = positive_vertical & x_horizontal;
+
+                if (positive_horizontal & last_row)
+                    ++score;
+                else if (negative_horizontal & last_row)
+                    --score;
+
+                //The top row of the DP matrix grows by one per column, hence the 1 shifted in
+                positive_horizontal = (positive_horizontal << 1) | 1;
+                negative_horizontal <<= 1;
+
+                positive_vertical = negative_horizontal | ~(x_vertical | positive_horizontal);
+                negative_vertical = positive_horizontal & x_vertical;
+
+                //Each remaining character can lower the score by at most one
+                if (score > limit and score - limit > text.length() - i - 1)
+                    return limit + 1;
+            }
+
+            return std::min(score, limit + 1);
+        }
+
+        void Suggestions::add(std::string_view name)
+        {
+            if (names_by_length.size() <= name.length())
+                names_by_length.resize(name.length() + 1);
+
+            names_by_length[name.length()].push_back(name);
+        }
+
+        void Suggestions::clear()
+        {
+            names_by_length.clear();
+        }
+
+        bool Suggestions::empty() const
+        {
+            return names_by_length.empty();
+        }
+
+        /*
+            Up to `max_results` (distance, name) pairs closest to `unknown`, best first; names more than 1 + length/4 edits
+            away are never suggested. Buckets are visited from the closest length outwards, and the limit shrinks to the
+            worst kept match once `max_results` have been found, so most candidates are cut off early or never visited.
+        */
+        std::vector<std::pair<std::size_t, std::string_view>> Suggestions::closest(std::string_view unknown, std::size_t max_results) const
+        {
+            std::vector<std::pair<std::size_t, std::string_view>> matches;
+            if (unknown.empty() or unknown.length() > EditDistance::max_pattern_length or max_results == 0)
+                return matches;
+
+            std::size_t limit = 1 + unknown.length() / 4;
+            EditDistance edit_distance(unknown);
+
+            auto visit_bucket = [&](std::size_t length)
+            {
+                if (length >= names_by_length.size())
+                    return;
+
+                for (std::string_view name : names_by_length[length])
+                {
+                    std::pair<std::size_t, std::string_view> match(edit_distance.distance(name, limit), name);
+                    if (match.first > limit or (matches.size() == max_results and not (match < matches.back())))
+                        continue;
+
+                    matches.insert(std::upper_bound(matches.begin(), matches.end(), match), match);
+                    if (matches.size() > max_results)
+                        matches.pop_back();
+
+                    if (matches.size() == max_results)
+                        limit = matches.back().first;
+                }
+            };
+
+            visit_bucket(unknown.length());
+            for (std::size_t offset = 1; offset <= limit; ++offset)
+            {
+                if (offset <= unknown.length())
+                    visit_bucket(unknown.length() - offset);
+
+                visit_bucket(unknown.length() + offset);
+            }
+
+            return matches;
+        }
+    }
+}
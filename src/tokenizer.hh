@@ -0,0 +1,290 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Splits a single command line into arguments the way a POSIX shell would, minus expansions:
+      - unquoted whitespace separates arguments
+      - '...' keeps everything up to the next single quote literally
+      - "..." keeps everything literally except for \" \\ \$ \` and \<newline>
+      - outside of quotes, a backslash escapes the following character (\<newline> is removed)
+
+    Tokens are views into the line wherever possible; only tokens that contain quotes or escapes
+    are rewritten, into an arena owned by the tokenizer. Both stay valid until the next call to split().
+    The arena is scratch space, so copying a tokenizer (and with it a `Parser`) copies neither it nor
+    the tokens: the copy starts out empty.
+
+    POSIX Shell Command Language, section 2.2 "Quoting": https://pubs.opengroup.org/onlinepubs/9699919799/utilities/V3_chap02.html#tag_18_02
+*/
+
+namespace carp
+{
+    class Tokenizer final
+    {
+        public:
+            Tokenizer() = default;
+            Tokenizer(const Tokenizer&);
+            Tokenizer(Tokenizer&&) = default;
+            Tokenizer& operator=(const Tokenizer&);
+            Tokenizer& operator=(Tokenizer&&) = default;
+
+            const std::vector<std::string_view>& split(std::string_view);
+
+        private:
+            const char* unescape(const char*, const char*, char*&) const;
+
+            std::vector<std::string_view> tokens;
+            std::unique_ptr<char[]> arena;
+            std::size_t arena_capacity = 0;
+    };
+
+    namespace detail
+    {
+        //ASCII letters, and every byte of a non-ASCII UTF-8 character, so that names like "--größe" are options
+        constexpr bool is_name_letter(char c)
+        {
+            return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or static_cast<unsigned char>(c) >= 0x80;
+        }
+
+        /*
+            Whether a token has the shape of an option: one or two dashes, a letter, then letters, digits, dashes and dots,
+            where a digit never starts a segment (what follows a dot), i.e. the regex
+            "^(-|--)[a-zA-Z]([a-zA-Z0-9-]|\.+[a-zA-Z-])*\.*$" with non-ASCII letters allowed as well. Dots separate
+            namespaces, as in "--cache.l2.size" (see namespace-tree.hh), and since numbers start with a digit, "-4" and
+            "-2.5" stay values. The simpler "^(-|--)[a-zA-Z-]+$" would accept '--' as an option, which violates POSIX
+            Utility Syntax Guideline 10. Matched by hand: std::regex is slow, recursive, and large. Whether the non-ASCII
+            bytes are valid UTF-8 is left to `Parser::require_utf8`.
+        */
+        constexpr bool is_option_token(std::string_view token)
+        {
+            std::size_t dashes = token.substr(0, 2) == "--" ? 2 : token.substr(0, 1) == "-" ? 1 : 0;
+            if (dashes == 0 or token.size() == dashes or not is_name_letter(token[dashes]))
+                return false;
+
+            for (std::size_t i = dashes + 1; i < token.size(); ++i)
+            {
+                bool is_digit = token[i] >= '0' and token[i] <= '9';
+                if (not is_name_letter(token[i]) and token[i] != '-' and token[i] != '.' and not (is_digit and token[i - 1] != '.'))
+                    return false;
+            }
+
+            return true;
+        }
+
+        constexpr bool is_shell_space(char c)
+        {
+            return c == ' ' or (c >= '\t' and c <= '\r');
+        }
+
+        constexpr bool is_shell_structural(char c)
+        {
+            return is_shell_space(c) or c == '\'' or c == '"' or c == '\\';
+        }
+
+        //Returns the first whitespace, quote or backslash in [begin, end), or end if there is none
+        const char* find_shell_structural(const char* begin, const char* end)
+        {
+            #if defined(__SSE2__)
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i single_quote = _mm_set1_epi8('\'');
+            const __m128i double_quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+
+            while (end - begin >= 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+
+                //'\t' through '\r' as one unsigned range check: (c - '\t') <= ('\r' - '\t')
+                __m128i offset = _mm_sub_epi8(chunk, tab);
+                __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(offset, control_span), offset);
+
+                __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), controls),
+                                               _mm_or_si128(_mm_cmpeq_epi8(chunk, single_quote),
+                                                            _mm_or_si128(_mm_cmpeq_epi8(chunk, double_quote),
+                                                                         _mm_cmpeq_epi8(chunk, backslash))));
+
+                if (int mask = _mm_movemask_epi8(matches))
+                    return begin + __builtin_ctz(mask);
+
+                begin += 16;
+            }
+            #endif
+
+            while (begin != end and not is_shell_structural(*begin))
+                ++begin;
+
+            return begin;
+        }
+
+        //Returns the first '"' or '\' in [begin, end), or end if there is none
+        const char* find_double_quote_structural(const char* begin, const char* end)
+        {
+            #if defined(__SSE2__)
+            const __m128i double_quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+
+            while (end - begin >= 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, double_quote), _mm_cmpeq_epi8(chunk, backslash));
+
+                if (int mask = _mm_movemask_epi8(matches))
+                    return begin + __builtin_ctz(mask);
+
+                begin += 16;
+            }
+            #endif
+
+            while (begin != end and *begin != '"' and *begin != '\\')
+                ++begin;
+
+            return begin;
+        }
+    }
+
+    Tokenizer::Tokenizer(const Tokenizer&)
+    {
+    }
+
+    //Keeps this tokenizer's own arena for reuse, but drops its tokens, which the other tokenizer's would replace
+    Tokenizer& Tokenizer::operator=(const Tokenizer&)
+    {
+        tokens.clear();
+        return *this;
+    }
+
+    const std::vector<std::string_view>& Tokenizer::split(std::string_view line)
+    {
+        tokens.clear();
+
+        const char* cursor = line.data();
+        const char* end = line.data() + line.size();
+        char* out = nullptr;
+
+        while (true)
+        {
+            while (cursor != end and detail::is_shell_space(*cursor))
+                ++cursor;
+
+            if (cursor == end)
+                break;
+
+            const char* token_begin = cursor;
+            cursor = detail::find_shell_structural(cursor, end);
+
+            if (cursor == end or detail::is_shell_space(*cursor))
+            {
+                tokens.emplace_back(token_begin, cursor - token_begin);
+                continue;
+            }
+
+            //An unescaped token never grows, so an arena as large as the line is always enough
+            if (out == nullptr)
+            {
+                if (arena_capacity < line.size())
+                {
+                    arena.reset(new char[line.size()]);
+                    arena_capacity = line.size();
+                }
+
+                out = arena.get();
+            }
+
+            char* unescaped_begin = out;
+            std::memcpy(out, token_begin, cursor - token_begin);
+            out += cursor - token_begin;
+
+            cursor = unescape(cursor, end, out);
+            tokens.emplace_back(unescaped_begin, out - unescaped_begin);
+        }
+
+        return tokens;
+    }
+
+    //Copies the rest of a token that needs unquoting into `out`, returning where the token ends in the line
+    const char* Tokenizer::unescape(const char* cursor, const char* end, char*& out) const
+    {
+        while (cursor != end and not detail::is_shell_space(*cursor))
+        {
+            switch (*cursor)
+            {
+                case '\\':
+                    if (++cursor == end)
+                        throw std::runtime_error("command line ends with an unescaped backslash");
+
+                    if (*cursor != '\n')
+                        *out++ = *cursor;
+
+                    ++cursor;
+                    break;
+
+                case '\'':
+                {
+                    const char* closing = static_cast<const char*>(std::memchr(cursor + 1, '\'', end - cursor - 1));
+                    if (closing == nullptr)
+                        throw std::runtime_error("unterminated single quote in command line");
+
+                    std::memcpy(out, cursor + 1, closing - cursor - 1);
+                    out += closing - cursor - 1;
+                    cursor = closing + 1;
+                    break;
+                }
+
+                case '"':
+                    ++cursor;
+                    while (true)
+                    {
+                        const char* stop = detail::find_double_quote_structural(cursor, end);
+                        std::memcpy(out, cursor, stop - cursor);
+                        out += stop - cursor;
+                        cursor = stop;
+
+                        if (cursor == end)
+                            throw std::runtime_error("unterminated double quote in command line");
+
+                        if (*cursor == '"')
+                        {
+                            ++cursor;
+                            break;
+                        }
+
+                        //Inside double quotes, a backslash only escapes characters that would otherwise be special
+                        if (++cursor == end)
+                            throw std::runtime_error("unterminated double quote in command line");
+
+                        if (*cursor == '"' or *cursor == '\\' or *cursor == '$' or *cursor == '`')
+                            *out++ = *cursor;
+                        else if (*cursor != '\n')
+                        {
+                            *out++ = '\\';
+                            *out++ = *cursor;
+                        }
+
+                        ++cursor;
+                    }
+                    break;
+
+                default:
+                {
+                    const char* stop = detail::find_shell_structural(cursor, end);
+                    std::memcpy(out, cursor, stop - cursor);
+                    out += stop - cursor;
+                    cursor = stop;
+                    break;
+                }
+            }
+        }
+
+        return cursor;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    UTF-8 validation for `Parser::require_utf8`. Command lines are overwhelmingly ASCII, so the validator skips
+    16 bytes at a time while their high bits are all clear (one load and one movemask), and only checks the
+    multi-byte sequences it stops at one by one. A sequence is valid when it is one of the well-formed byte
+    sequences of the Unicode Standard: no overlong encodings, no surrogates, nothing above U+10FFFF.
+
+    The Unicode Standard, Version 15.0, Table 3-7 "Well-Formed UTF-8 Byte Sequences": https://www.unicode.org/versions/Unicode15.0.0/ch03.pdf
+*/
+
+namespace carp
+{
+    namespace detail
+    {
+        //Returns the first byte of the first ill-formed sequence in `text`, or `text.size()` if it is all valid UTF-8
+        std::size_t find_invalid_utf8(std::string_view text)
+        {
+            const unsigned char* begin = reinterpret_cast<const unsigned char*>(text.data());
+            const unsigned char* end = begin + text.size();
+            const unsigned char* cursor = begin;
+
+            while (cursor != end)
+            {
+                #if defined(__SSE2__)
+                while (end - cursor >= 16)
+                {
+                    int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor)));
+                    if (mask != 0)
+                    {
+                        cursor += __builtin_ctz(mask);
+                        break;
+                    }
+
+                    cursor += 16;
+                }
+
+                if (cursor == end)
+                    break;
+                #endif
+
+                if (*cursor < 0x80)
+                {
+                    ++cursor;
+                    continue;
+                }
+
+                //The range of the second byte depends on the first; every later byte is 80..BF
+                std::ptrdiff_t length;
+                unsigned char low = 0x80;
+                unsigned char high = 0xBF;
+
+                if (*cursor >= 0xC2 and *cursor <= 0xDF)
+                {
+                    length = 2;
+                }
+                else if (*cursor >= 0xE0 and *cursor <= 0xEF)
+                {
+                    length = 3;
+                    low = *cursor == 0xE0 ? 0xA0 : low;     //overlong
+                    high = *cursor == 0xED ? 0x9F : high;   //surrogates
+                }
+                else if (*cursor >= 0xF0 and *cursor <= 0xF4)
+                {
+                    length = 4;
+                    low = *cursor == 0xF0 ? 0x90 : low;     //overlong
+                    high = *cursor == 0xF4 ? 0x8F : high;   //above U+10FFFF
+                }
+                else
+                {
+                    return cursor - begin;
+                }
+
+                if (end - cursor < length or cursor[1] < low or cursor[1] > high)
+                    return cursor - begin;
+
+                for (std::ptrdiff_t i = 2; i < length; ++i)
+                {
+                    if ((cursor[i] & 0xC0) != 0x80)
+                        return cursor - begin;
+                }
+
+                cursor += length;
+            }
+
+            return text.size();
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <optional>
+#include <chrono>
+
+/*
+    A Validator checks a single value of an argument, e.g. that a path exists or that a port is free.
+    The parser runs every validator attached to a provided argument concurrently once all arguments have
+    been read (see `Parser::validate_values`), so startup waits for the slowest check rather than all of them.
+
+    Pure validators (the default) always give the same answer for the same value, so their results are cached:
+    each distinct value is checked once, even when it is repeated, shared by several arguments, or parsed again.
+*/
+
+namespace carp
+{
+    class Validator final
+    {
+        public:
+            Validator(std::function<bool(std::string_view)>, bool);
+
+            bool check(const std::string&);
+            std::optional<bool> cached(const std::string&);
+
+        private:
+            bool run(std::string_view) const;
+
+            std::function<bool(std::string_view)> predicate;
+            bool pure;
+
+            std::mutex cache_mutex;
+            std::unordered_map<std::string, std::shared_future<bool>> cache;
+    };
+
+    Validator::Validator(std::function<bool(std::string_view)> check, bool is_pure = true)
+    {
+        predicate = std::move(check);
+        pure = is_pure;
+    }
+
+    //Safe to call from several threads at once; concurrent checks of the same value wait for a single evaluation
+    bool Validator::check(const std::string& value)
+    {
+        if (not pure)
+            return run(value);
+
+        std::promise<bool> promise;
+        std::shared_future<bool> result;
+        bool owner = false;
+
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto [entry, inserted] = cache.try_emplace(value);
+
+            if (inserted)
+            {
+                entry->second = promise.get_future().share();
+                owner = true;
+            }
+
+            result = entry->second;
+        }
+
+        if (owner)
+            promise.set_value(run(value));
+
+        return result.get();
+    }
+
+    //The answer for `value` if it is already known, i.e. a pure validator has finished checking it; never runs the predicate
+    std::optional<bool> Validator::cached(const std::string& value)
+    {
+        if (not pure)
+            return std::nullopt;
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto entry = cache.find(value);
+
+        if (entry == cache.end() or entry->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return std::nullopt;
+
+        return entry->second.get();
+    }
+
+    //A predicate that throws rejects the value
+    bool Validator::run(std::string_view value) const
+    {
+        try
+        {
+            return predicate(value);
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+}
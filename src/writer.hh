@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string_view>
+#include <charconv>
+#include <memory>
+#include <type_traits>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+    Help text and debug output are formatted with a Writer instead of iostreams, which keeps <iostream> (and its
+    static initialization) out of every program that uses the parser. A Writer fills a caller-provided buffer and,
+    like snprintf, keeps counting once the buffer is full, so `required()` tells how large a buffer the whole text needs.
+*/
+
+namespace carp
+{
+    class Writer final
+    {
+        public:
+            Writer(char*, std::size_t);
+
+            Writer& append(std::string_view);
+            Writer& append(char);
+
+            template <typename T,
+            typename = std::enable_if_t<std::is_integral_v<T>>>
+            Writer& append_number(T);
+
+            std::size_t required() const;
+            bool truncated() const;
+            std::string_view view() const;
+
+        private:
+            char* buffer;
+            std::size_t capacity;
+            std::size_t length;
+    };
+
+    Writer::Writer(char* out, std::size_t size)
+    {
+        buffer = out;
+        capacity = size;
+        length = 0;
+    }
+
+    Writer& Writer::append(std::string_view text)
+    {
+        if (length < capacity)
+            text.copy(buffer + length, capacity - length);
+
+        length += text.size();
+        return *this;
+    }
+
+    Writer& Writer::append(char c)
+    {
+        if (length < capacity)
+            buffer[length] = c;
+
+        ++length;
+        return *this;
+    }
+
+    template <typename T, typename>
+    Writer& Writer::append_number(T value)
+    {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        return append(std::string_view(digits, result.ptr - digits));
+    }
+
+    std::size_t Writer::required() const
+    {
+        return length;
+    }
+
+    bool Writer::truncated() const
+    {
+        return length > capacity;
+    }
+
+    //What was written, cut off at the end of the buffer
+    std::string_view Writer::view() const
+    {
+        return std::string_view(buffer, length < capacity ? length : capacity);
+    }
+
+    namespace detail
+    {
+        //Writes all of `text` to a file descriptor, retrying after partial writes and interrupts
+        bool write_all(int fd, std::string_view text)
+        {
+            while (not text.empty())
+            {
+                #ifdef _WIN32
+                auto written = _write(fd, text.data(), static_cast<unsigned int>(text.size()));
+                #else
+                auto written = ::write(fd, text.data(), text.size());
+                #endif
+
+                if (written < 0 and errno == EINTR)
+                    continue;
+
+                if (written <= 0)
+                    return false;
+
+                text.remove_prefix(written);
+            }
+
+            return true;
+        }
+
+        /*
+            Flushes what the program has buffered in stdout or stderr, so that a raw write to fd 1 or 2 comes after it
+            even when the stream is a pipe or a file. std::cout and std::clog write through those buffers unless the
+            program called std::ios::sync_with_stdio(false), in which case it has to flush them itself first.
+        */
+        void flush_standard_stream(int fd)
+        {
+            if (fd != 1 and fd != 2)
+                return;
+
+            std::fflush(fd == 1 ? stdout : stderr);
+        }
+
+        //Runs `format(Writer&)` and hands everything it wrote to `fd` in a single write, after what is buffered for it
+        template <typename Format>
+        bool write_formatted(int fd, const Format& format)
+        {
+            flush_standard_stream(fd);
+
+            char stack_buffer[4096];
+            Writer writer(stack_buffer, sizeof(stack_buffer));
+            format(writer);
+
+            if (not writer.truncated())
+                return write_all(fd, writer.view());
+
+            std::unique_ptr<char[]> heap_buffer(new char[writer.required()]);
+            Writer large_writer(heap_buffer.get(), writer.required());
+            format(large_writer);
+
+            return write_all(fd, large_writer.view());
+        }
+    }
+}
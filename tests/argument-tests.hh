@@ -3,11 +3,46 @@
 #ifdef CARP_DEBUG
 
 #include <memory>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
 #include <cassert>
 
 #include "test-utils.hh"
 #include "../src/argument.hh"
 
+namespace tests 
+{
+    enum class LogLevel
+    {
+        Error,
+        Warning,
+        Info,
+        Debug
+    };
+
+    template <typename Void, typename Text>
+    struct can_name : std::false_type {};
+
+    template <typename Text>
+    struct can_name<std::void_t<decltype(std::declval<carp::CmdArg&>().name(std::declval<Text>()))>, Text> : std::true_type {};
+}
+
+namespace carp
+{
+    template <>
+    struct enum_names<tests::LogLevel>
+    {
+        static constexpr std::array<std::pair<std::string_view, tests::LogLevel>, 4> values {{
+            {"error", tests::LogLevel::Error},
+            {"warning", tests::LogLevel::Warning},
+            {"info", tests::LogLevel::Info},
+            {"debug", tests::LogLevel::Debug}
+        }};
+    };
+}
+
 namespace tests 
 {
     class ArgumentTests
@@ -18,12 +53,12 @@ namespace tests
             std::shared_ptr<carp::CmdArg> arg = carp::CmdArg("default")
                                                         .build();
             assert(arg->identifier == "default");
-            assert(arg->long_name == "--default");
-            assert(arg->short_name == "-default");
+            assert(arg->long_name == "default");
+            assert(arg->short_name == "default");
             assert(arg->enforced == false);
             assert(arg->set == false);
             assert(arg->on_parse = carp::ArgAction::SetTrue);
-            assert(arg->values.size() == 1);
+            assert(arg->values.empty());
             assert(arg->count == 0);
         }
 
@@ -36,16 +71,110 @@ namespace tests
                                                         .build();
 
             assert(arg->identifier == "foo");
-            assert(arg->long_name == "--foo");
-            assert(arg->short_name == "-f");
+            assert(arg->long_name == "foo");
+            assert(arg->short_name == "f");
             assert(arg->enforced == true);
             assert(arg->description == "this argument does stuff");
         }
 
+        static void summary_lists_choices()
+        {
+            std::shared_ptr<carp::CmdArg> arg = carp::CmdArg("log-level")
+                                                        .abbreviation("l")
+                                                        .help("verbosity of the log")
+                                                        .choices<LogLevel>()
+                                                        .build();
+
+            assert(arg->summary() == "[Optional] log-level (--log-level, -l): \tverbosity of the log {error|warning|info|debug}");
+        }
+
+        static void lazy_default_values()
+        {
+            std::atomic<int> evaluations {0};
+            carp::CmdArg definition = carp::CmdArg("jobs")
+                                            .abbreviation("j")
+                                            .help("parallel jobs")
+                                            .action(carp::ArgAction::StoreSingle)
+                                            .default_value([&evaluations]() { evaluations++; return std::to_string(4); }, "one per core");
+
+            //Neither building nor the help screen computes the default
+            std::shared_ptr<carp::CmdArg> arg = definition.build();
+            assert(arg->summary() == "[Optional] jobs (--jobs, -j): \tparallel jobs [default: one per core]");
+            assert(evaluations == 0);
+
+            //Concurrent first reads compute it once, and copies of the definition share the result
+            std::vector<std::thread> readers;
+            for (int i = 0; i < 8; ++i)
+                readers.emplace_back([&arg]() { assert(arg->try_parse_integer<int>() == 4); });
+
+            for (std::thread& reader : readers)
+                reader.join();
+
+            assert(definition.try_parse_integer<int>() == 4);
+            assert(evaluations == 1);
+            assert(not arg->is_set());
+
+            //A value given on the command line wins
+            arg->set = true;
+            arg->values.assign(1, "16");
+            assert(arg->try_parse_integer<int>() == 16);
+
+            std::shared_ptr<carp::CmdArg> constant = carp::CmdArg("level").abbreviation("l").default_value("info").build();
+            assert(constant->summary() == "[Optional] level (--level, -l): \t [default: info]");
+            assert(constant->try_parse_enum<LogLevel>() == LogLevel::Info);
+            assert(carp::CmdArg("missing").try_parse_integer<int>() == std::nullopt);
+        }
+
+        //Views of a std::string temporary would dangle, so those overloads are deleted; lvalues and literals still work
+        static void rejects_temporary_strings()
+        {
+            static_assert(not std::is_constructible_v<carp::CmdArg, std::string>);
+            static_assert(std::is_constructible_v<carp::CmdArg, const std::string&>);
+            static_assert(std::is_constructible_v<carp::CmdArg, std::string&>);
+            static_assert(std::is_constructible_v<carp::CmdArg, const char*>);
+
+            static_assert(not can_name<void, std::string>::value);
+            static_assert(can_name<void, std::string&>::value);
+            static_assert(can_name<void, std::string_view>::value);
+
+            std::string name = "plugin-" + std::to_string(7);
+            carp::CmdArg arg(name);
+            arg.name(name).abbreviation("p").help(name);
+            assert(arg.get_name().data() == name.data());
+        }
+
+        static void definition_allocations()
+        {
+            constexpr std::size_t n = 1000;
+            std::vector<std::shared_ptr<carp::CmdArg>> args;
+            args.reserve(n);
+
+            //Each definition makes exactly one allocation: the shared_ptr's combined control block and object
+            std::size_t before = allocation_count;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                args.push_back(carp::CmdArg("compression-level")
+                                        .name("level")
+                                        .abbreviation("l")
+                                        .help("a help text long enough that copying it would need the heap")
+                                        .required(true)
+                                        .action(carp::ArgAction::StoreSingle)
+                                        .choices<LogLevel>()
+                                        .build());
+            }
+
+            assert(allocation_count - before == n);
+        }
+
+        //Allocation budgets: what each test allocated (with libstdc++) when its budget was set, plus 5%
         static void driver() 
         {
-            test(__FILE__, stringify(default_constructor), default_constructor);
-            test(__FILE__, stringify(parameterized_constructor), parameterized_constructor);
+            test(__FILE__, stringify(default_constructor), {2, 278}, default_constructor);
+            test(__FILE__, stringify(parameterized_constructor), {2, 278}, parameterized_constructor);
+            test(__FILE__, stringify(summary_lists_choices), {3, 371}, summary_lists_choices);
+            test(__FILE__, stringify(lazy_default_values), {23, 1250}, lazy_default_values);
+            test(__FILE__, stringify(rejects_temporary_strings), {0, 0}, rejects_temporary_strings);
+            test(__FILE__, stringify(definition_allocations), {1052, 294000}, definition_allocations);
             std::cout << '\n';
         }
     };
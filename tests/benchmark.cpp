@@ -0,0 +1,13 @@
+#ifndef CARP_DEBUG
+    #error Cannot run benchmarks without the "CARP_DEBUG" flag.
+#endif
+
+#include "benchmarks.hh"
+
+//Build with optimizations, e.g. `g++ -std=c++17 -O2 -DCARP_DEBUG tests/benchmark.cpp`
+int main()
+{
+    tests::Benchmarks::driver();
+
+    return 0;
+}
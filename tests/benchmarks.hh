@@ -0,0 +1,302 @@
+#pragma once
+
+#ifdef CARP_DEBUG
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <regex>
+#include <cassert>
+
+#include "test-utils.hh"
+#include "../src/parser.hh"
+
+namespace tests
+{
+    struct Port
+    {
+        unsigned int number;
+    };
+
+    bool parse_port(const std::vector<std::string>& values, Port& port)
+    {
+        return std::from_chars(values[0].data(), values[0].data() + values[0].size(), port.number).ec == std::errc{};
+    }
+}
+
+namespace carp
+{
+    template <>
+    struct converter<tests::Port>
+    {
+        static std::optional<tests::Port> convert(const std::vector<std::string>& values) noexcept
+        {
+            unsigned int number;
+            if (std::from_chars(values[0].data(), values[0].data() + values[0].size(), number).ec != std::errc{})
+                return std::nullopt;
+
+            return tests::Port{number};
+        }
+    };
+}
+
+namespace tests
+{
+    class Benchmarks
+    {
+        public:
+        //A single command line of roughly `size` bytes, made of `token` repeated
+        static std::string long_line(std::string_view token, std::size_t size)
+        {
+            std::string line;
+            line.reserve(size + token.size());
+
+            while (line.size() < size)
+                line.append(token);
+
+            return line;
+        }
+
+        static void tokenize_plain_line()
+        {
+            std::string line = long_line("--input /var/lib/service/data/segment-000123.bin ", 64 << 20);
+            carp::Tokenizer tokenizer;
+
+            benchmark(__FILE__, stringify(tokenize_plain_line), line.size(), 10, [&]() {
+                assert(not tokenizer.split(line).empty());
+            });
+        }
+
+        static void tokenize_quoted_line()
+        {
+            std::string line = long_line(R"(--name "John \"JJ\" Smith" 'single quoted value' escaped\ space )", 64 << 20);
+            carp::Tokenizer tokenizer;
+
+            benchmark(__FILE__, stringify(tokenize_quoted_line), line.size(), 10, [&]() {
+                assert(not tokenizer.split(line).empty());
+            });
+        }
+
+        static void validate_utf8()
+        {
+            std::string ascii = long_line("--input /var/lib/service/data/segment-000123.bin ", 64 << 20);
+            std::string mixed = long_line("--größe /srv/données/résumé-№123.bin --名前 ", 64 << 20);
+
+            benchmark(__FILE__, "validate_utf8 (ascii)", ascii.size(), 10, [&]() {
+                assert(carp::detail::find_invalid_utf8(ascii) == ascii.size());
+            });
+
+            benchmark(__FILE__, "validate_utf8 (mixed)", mixed.size(), 10, [&]() {
+                assert(carp::detail::find_invalid_utf8(mixed) == mixed.size());
+            });
+        }
+
+        //Checking values against a pattern: the compiled DFA, then std::regex_match on the same values for reference
+        static void match_pattern()
+        {
+            const char* source = "[a-z0-9-]+(\\.[a-z0-9-]+)*:[0-9]{1,5}";
+            carp::Pattern pattern(source);
+            std::regex regex(source);
+
+            std::string value = "replica-03.db.eu-west-1.internal.example.com:5432";
+            std::string line = long_line("segment-000123.", 64 << 20) + "bin:443";
+
+            benchmark(__FILE__, "match_pattern (value)", 1000000, [&]() {
+                assert(pattern.matches(value));
+            });
+
+            benchmark(__FILE__, "match_pattern (value, std::regex)", 100000, [&]() {
+                assert(std::regex_match(value, regex));
+            });
+
+            benchmark(__FILE__, "match_pattern (64 MB value)", line.size(), 10, [&]() {
+                assert(pattern.matches(line));
+            });
+        }
+
+        static void parse_long_line()
+        {
+            std::string line = "--input " + long_line("/var/lib/service/data/segment-000123.bin ", 4 << 20);
+
+            benchmark(__FILE__, stringify(parse_long_line), line.size(), 3, [&]() {
+                carp::Parser parser(
+                    carp::CmdArg("input")
+                            .abbreviation("i")
+                            .action(carp::ArgAction::StoreMany)
+                            .build()
+                );
+
+                parser.parse(line);
+            });
+        }
+
+        static void suggest_unknown_argument()
+        {
+            //Plugin-sized schema: thousands of names, a few dozen of any given length
+            std::vector<std::string> names;
+            for (int i = 0; i < 5000; ++i)
+                names.push_back("plugin-" + std::to_string(i % 97) + "-option-" + std::string(i % 23, 'x'));
+
+            carp::detail::Suggestions suggestions;
+            for (const std::string& name : names)
+                suggestions.add(name);
+
+            benchmark(__FILE__, stringify(suggest_unknown_argument), 100000, [&]() {
+                assert(not suggestions.closest("plugin-42-optoin-xxxxx", 3).empty());
+            });
+        }
+
+        //The same conversion through `try_parse_user_defined` and through a `carp::converter`
+        static void convert_user_defined()
+        {
+            carp::Parser parser(carp::CmdArg("port").abbreviation("p").action(carp::ArgAction::StoreSingle).build());
+            char* argv[] { const_cast<char*>("program_name"), const_cast<char*>("--port"), const_cast<char*>("8443") };
+            parser.parse(3, argv);
+
+            std::shared_ptr<carp::CmdArg> port = parser.get_arg("port");
+            unsigned long sum = 0;
+
+            benchmark(__FILE__, "convert_user_defined (std::function)", 1000000, [&]() {
+                sum += port->try_parse_user_defined<Port>(parse_port)->number;
+            });
+
+            benchmark(__FILE__, "convert_user_defined (converter)", 1000000, [&]() {
+                sum += port->try_parse<Port>()->number;
+            });
+
+            assert(sum == 2 * 1000000ul * 8443);
+        }
+
+        static void register_plugin_arguments()
+        {
+            constexpr std::size_t count = 50000;
+            std::vector<std::string> names;
+            std::vector<carp::CmdArgSpec> specs;
+            names.reserve(count);
+            specs.reserve(count);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                names.push_back("plugin-option-" + std::to_string(i));
+                specs.push_back({names.back(), "", "", "an option registered by a plugin", false, carp::ArgAction::StoreSingle});
+            }
+
+            benchmark(__FILE__, stringify(register_plugin_arguments), 10, [&]() {
+                carp::Parser parser;
+                parser.add_arguments(specs);
+            });
+        }
+
+        /*
+            Every thread reads two flags a million times. With linear scaling the time stays flat as threads are
+            added (up to the number of cores); the shared_ptr reads of `get_arg` all bump the same reference counts.
+        */
+        static void read_scaling()
+        {
+            carp::Parser parser(
+                carp::CmdArg("quiet").abbreviation("q").action(carp::ArgAction::SetTrue).build(),
+                carp::CmdArg("threads").abbreviation("t").action(carp::ArgAction::StoreSingle).build()
+            );
+
+            parser.parse("-q --threads 8");
+            const carp::FrozenArgs frozen = parser.freeze();
+            constexpr int reads = 1000000;
+
+            auto run = [](unsigned int thread_count, const auto& read)
+            {
+                std::vector<std::thread> pool;
+                std::atomic<long> total {0};
+
+                for (unsigned int i = 0; i < thread_count; ++i)
+                {
+                    pool.emplace_back([&]()
+                    {
+                        long sum = 0;
+                        for (int j = 0; j < reads; ++j)
+                            sum += read();
+
+                        total += sum;
+                    });
+                }
+
+                for (std::thread& thread : pool)
+                    thread.join();
+
+                assert(total == 9l * reads * thread_count);
+            };
+
+            for (unsigned int threads : { 1u, 2u, 4u, 8u, 16u })
+            {
+                std::string name = "read get_arg (" + std::to_string(threads) + " threads, 1M reads each)";
+                benchmark(__FILE__, name.c_str(), 1, [&]() {
+                    run(threads, [&]() { return *parser.get_arg("quiet")->try_parse_bool() + *parser.get_arg("--threads")->try_parse_integer<int>(); });
+                });
+
+                name = "read FrozenArgs (" + std::to_string(threads) + " threads, 1M reads each)";
+                benchmark(__FILE__, name.c_str(), 1, [&]() {
+                    run(threads, [&]() { return *frozen.get_arg("quiet").try_parse_bool() + *frozen.get_arg("--threads").try_parse_integer<int>(); });
+                });
+            }
+        }
+
+        //Reports how parse_parallel scales with threads; compare against the serial parse on the first line
+        static void parse_parallel_scaling()
+        {
+            std::vector<std::string> storage { "program_name" };
+            while (storage.size() < 2000000)
+            {
+                storage.push_back(storage.size() % 1000 == 1 ? "--verbose" : "--input");
+                for (int i = 0; i < 99; ++i)
+                    storage.push_back("/var/lib/service/data/segment-" + std::to_string(storage.size()) + ".bin");
+            }
+
+            std::vector<char*> argv;
+            std::size_t bytes = 0;
+            for (std::string& arg : storage)
+            {
+                argv.push_back(arg.data());
+                bytes += arg.size();
+            }
+
+            auto make_parser = []()
+            {
+                return carp::Parser(
+                    carp::CmdArg("input").abbreviation("i").action(carp::ArgAction::StoreMany).build(),
+                    carp::CmdArg("verbose").abbreviation("v").action(carp::ArgAction::Count).build()
+                );
+            };
+
+            benchmark(__FILE__, "parse (serial, 2M tokens)", bytes, 1, [&]() {
+                carp::Parser parser = make_parser();
+                parser.parse(argv.size(), argv.data());
+            });
+
+            for (unsigned int threads : { 1u, 2u, 4u, 8u, 16u })
+            {
+                std::string name = "parse_parallel (" + std::to_string(threads) + " threads, 2M tokens)";
+                benchmark(__FILE__, name.c_str(), bytes, 1, [&]() {
+                    carp::Parser parser = make_parser();
+                    parser.parse_parallel(argv.size(), argv.data(), threads);
+                });
+            }
+        }
+
+        static void driver()
+        {
+            tokenize_plain_line();
+            tokenize_quoted_line();
+            validate_utf8();
+            match_pattern();
+            parse_long_line();
+            suggest_unknown_argument();
+            convert_user_defined();
+            register_plugin_arguments();
+            parse_parallel_scaling();
+            read_scaling();
+            std::cout << '\n';
+        }
+    };
+}
+#endif
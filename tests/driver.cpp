@@ -4,12 +4,16 @@
 
 #include "parser-tests.hh"
 #include "argument-tests.hh"
+#include "tokenizer-tests.hh"
+#include "pattern-tests.hh"
 
 //oh my god unit tests without a framework is so bad
 //why is c/c++'s infrastructure so bad
 int main()
 {
     tests::ArgumentTests::driver();
+    tests::TokenizerTests::driver();
+    tests::PatternTests::driver();
     tests::ParserTests::driver();
     std::cout << "All tests passed successfully!\n";
 
@@ -0,0 +1,13 @@
+#include "../src/parser.hh"
+
+//A minimal program using the parser, for tracking binary size and startup time (see footprint.sh)
+int main(int argc, char* argv[])
+{
+    carp::Parser parser(
+        carp::CmdArg("input").abbreviation("i").action(carp::ArgAction::StoreMany).build(),
+        carp::CmdArg("verbose").abbreviation("v").action(carp::ArgAction::Count).build()
+    );
+
+    parser.parse(argc, argv);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+#Builds footprint.cpp and reports its size and the time for 500 runs from process start to return from main
+set -e
+
+cd "$(dirname "$0")"
+out="${TMPDIR:-/tmp}/carp-footprint"
+
+${CXX:-g++} -std=c++17 -O2 footprint.cpp -o "$out"
+echo "size:          $(wc -c < "$out") bytes"
+
+strip -o "$out.stripped" "$out"
+echo "size stripped: $(wc -c < "$out.stripped") bytes"
+
+start=$(date +%s%N)
+for i in $(seq 500); do
+    "$out" -i a -i b -v -v
+done
+end=$(date +%s%N)
+echo "500 runs:      $(( (end - start) / 1000000 )) ms"
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifdef CARP_DEBUG
+
+#include <string>
+#include <string_view>
+#include <cassert>
+
+#include "test-utils.hh"
+#include "../src/pattern.hh"
+
+namespace tests
+{
+    class PatternTests
+    {
+        public:
+        static void match_syntax()
+        {
+            struct Case
+            {
+                std::string_view pattern;
+                std::string_view value;
+                bool matches;
+            };
+
+            const Case cases[] {
+                {"abc", "abc", true}, {"abc", "ab", false}, {"abc", "abcd", false}, {"", "", true}, {"", "a", false},
+                {"a*", "", true}, {"a*", "aaaa", true}, {"a+", "", false}, {"a?b", "b", true}, {"a?b", "aab", false},
+                {"(ab|cd)+", "abcdab", true}, {"(ab|cd)+", "abc", false}, {"a|", "", true}, {"(a*)*b", "aaab", true},
+                {"x{3}", "xxx", true}, {"x{3}", "xx", false}, {"x{2,}", "xxxxx", true}, {"x{1,2}", "xxx", false},
+                {"[^a]", "b", true}, {"[^a]", "a", false}, {"[]a]", "]", true}, {"[a-]", "-", true}, {"[\\d.]+", "1.2", true},
+                {"\\w+", "a_1", true}, {"\\W", "a", false}, {"\\s\\S", " x", true}, {"a\\.b", "a.b", true}, {"a\\.b", "axb", false},
+                {".", "\n", true}, {"(a|b)*abb", "ababb", true}, {"(a|b)*abb", "abab", false},
+                {"gr\xC3\xB6\xC3\x9F" "e", "gr\xC3\xB6\xC3\x9F" "e", true}
+            };
+
+            for (const Case& c : cases)
+                assert(carp::Pattern(c.pattern).matches(c.value) == c.matches);
+
+            carp::Pattern host_port("[a-z0-9-]+(\\.[a-z0-9-]+)*:[0-9]{1,5}");
+            assert(host_port.matches("db.example.com:5432"));
+            assert(host_port.matches("localhost:80"));
+            assert(not host_port.matches("db..example.com:5432"));
+            assert(not host_port.matches("localhost:123456"));
+            assert(not host_port.matches("localhost"));
+            assert(host_port.source() == "[a-z0-9-]+(\\.[a-z0-9-]+)*:[0-9]{1,5}");
+        }
+
+        static void invalid_patterns()
+        {
+            for (std::string_view pattern : { "(", "a)", "[a", "*", "a**b|+", "a{2,1}", "a{", "a{1,", "\\", "\\q", "[b-a]", "[a-\\d]" })
+                assert(throws_exception([&]() { carp::Pattern{pattern}; }));
+
+            //Too large an NFA, and too many DFA states: matching any of 2^13 suffixes needs that many states
+            assert(throws_exception([]() { carp::Pattern("(a{1000}){1000}"); }));
+            assert(throws_exception([]() { carp::Pattern("(a|b)*a(a|b){12}"); }));
+            assert(carp::Pattern("(a|b)*a(a|b){8}").state_count() <= carp::Pattern::max_states);
+        }
+
+        static void linear_matching()
+        {
+            //Catastrophic for a backtracking matcher: each extra 'a' doubles the work before the final mismatch
+            carp::Pattern nested("(a*)*b");
+            std::string value(1 << 20, 'a');
+            assert(not nested.matches(value));
+
+            value.back() = 'b';
+            assert(nested.matches(value));
+
+            //The dead state, the start, and one after the 'b'
+            assert(nested.state_count() == 3);
+        }
+
+        static void driver()
+        {
+            test(__FILE__, stringify(match_syntax), match_syntax);
+            test(__FILE__, stringify(invalid_patterns), invalid_patterns);
+            test(__FILE__, stringify(linear_matching), linear_matching);
+            std::cout << '\n';
+        }
+    };
+}
+#endif
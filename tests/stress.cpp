@@ -0,0 +1,14 @@
+#ifndef CARP_DEBUG
+    #error Cannot run stress tests without the "CARP_DEBUG" flag.
+#endif
+
+#include "stress.hh"
+
+//Build with optimizations, e.g. `g++ -std=c++17 -O2 -DCARP_DEBUG -pthread tests/stress.cpp`
+int main()
+{
+    tests::StressTests::driver();
+    std::cout << "All stress tests passed successfully!\n";
+
+    return 0;
+}
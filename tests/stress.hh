@@ -0,0 +1,283 @@
+#pragma once
+
+#ifdef CARP_DEBUG
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <cassert>
+#include <pthread.h>
+
+#include "test-utils.hh"
+#include "../src/parser.hh"
+
+/*
+    Hostile and extreme command lines, at sizes that double from one run to the next. For every kind of input,
+    the time to parse has to grow linearly with its size (at worst `max_growth` times as fast, well below the
+    factor a quadratic parse would show), the most memory allocated at once has to stay within a fixed multiple
+    of it (where the allocator can tell, see `tracks_live_bytes`), and the parse has to fit in a small stack, so
+    that nothing recurses once per byte or per token.
+*/
+
+namespace tests
+{
+    class StressTests
+    {
+        public:
+        static constexpr std::size_t stack_size = 256 << 10;
+        static constexpr int steps = 4;                     //sizes n, 2n, 4n, 8n
+        static constexpr double max_growth = 3;             //8n may take up to 3 * 8 times as long as n; quadratic would be 64 times
+
+        struct Measurement
+        {
+            double milliseconds;
+            std::size_t peak_bytes;
+        };
+
+        static void* call(void* function)
+        {
+            (*static_cast<std::function<void()>*>(function))();
+            return nullptr;
+        }
+
+        //Runs `func` on a thread of its own with a `stack_size` stack; recursion that grows with the input overflows it
+        static void run_with_small_stack(const std::function<void()>& func)
+        {
+            std::exception_ptr error;
+            std::function<void()> guarded = [&]()
+            {
+                try
+                {
+                    func();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            };
+
+            pthread_attr_t attributes;
+            pthread_attr_init(&attributes);
+            pthread_attr_setstacksize(&attributes, stack_size);
+
+            pthread_t thread;
+            int status = pthread_create(&thread, &attributes, call, &guarded);
+            pthread_attr_destroy(&attributes);
+            assert(status == 0);
+
+            pthread_join(thread, nullptr);
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+        //The best time out of three runs, and the most memory allocated at once beyond what was allocated before
+        static Measurement measure(const std::function<void()>& func)
+        {
+            using fpms = std::chrono::duration<double, std::milli>;
+            Measurement result {1e300, 0};
+
+            for (int run = 0; run < 3; ++run)
+            {
+                std::size_t baseline = live_bytes.load();
+                reset_peak_bytes();
+                auto start = std::chrono::high_resolution_clock::now();
+
+                run_with_small_stack(func);
+
+                double elapsed_time = std::chrono::duration_cast<fpms>(std::chrono::high_resolution_clock::now() - start).count();
+                result.milliseconds = std::min(result.milliseconds, elapsed_time);
+                result.peak_bytes = std::max(result.peak_bytes, peak_bytes.load() - baseline);
+            }
+
+            return result;
+        }
+
+        /*
+            Parses `make_input(n)` for n = base, 2 * base, ... with `parse`, checking that time grows linearly and that the
+            peak memory stays below `memory_factor` times the size of the input.
+        */
+        static void check_scaling(const char* name, std::size_t base, double memory_factor,
+                                  const std::function<std::string(std::size_t)>& make_input,
+                                  const std::function<void(const std::string&)>& parse)
+        {
+            std::vector<Measurement> measurements;
+
+            for (int step = 0; step < steps; ++step)
+            {
+                std::string input = make_input(base << step);
+                Measurement measurement = measure([&]() { parse(input); });
+                measurements.push_back(measurement);
+
+                double ratio = static_cast<double>(measurement.peak_bytes) / input.size();
+                std::cout << '[' << __FILE__ << "] " << name << " (" << input.size() << " bytes)..."
+                          << measurement.milliseconds << "ms, peak " << measurement.peak_bytes << " bytes (" << ratio << "x input)\n";
+
+                assert(not tracks_live_bytes or ratio <= memory_factor);
+            }
+
+            double growth = measurements.back().milliseconds / measurements.front().milliseconds;
+            assert(growth <= max_growth * (1 << (steps - 1)));
+        }
+
+        static std::string repeat(std::string_view token, std::size_t count)
+        {
+            std::string line;
+            line.reserve(token.size() * count);
+
+            for (std::size_t i = 0; i < count; ++i)
+                line.append(token);
+
+            return line;
+        }
+
+        //libstdc++'s std::regex_match recurses once per character, so a single long token used to be enough to overflow the stack
+        static void huge_tokens()
+        {
+            auto parse_value = [](const std::string& line)
+            {
+                carp::Parser parser(carp::CmdArg("name").abbreviation("n").action(carp::ArgAction::StoreSingle).build());
+                parser.parse(line);
+                assert(parser.get_arg("name")->is_set());
+            };
+
+            check_scaling("huge_tokens (plain value)", 1 << 20, 4,
+                          [](std::size_t n) { return "--name " + std::string(n, 'x'); }, parse_value);
+
+            check_scaling("huge_tokens (quoted value)", 1 << 20, 6,
+                          [](std::size_t n) { return "--name 'a b" + std::string(n, 'x') + "'"; }, parse_value);
+
+            check_scaling("huge_tokens (option-shaped value)", 1 << 20, 4,
+                          [](std::size_t n) { return "--name -" + std::string(n, 'x'); },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(carp::CmdArg("name").abbreviation("n").action(carp::ArgAction::StoreSingle).build());
+                              assert(throws_exception([&]() { parser.parse(line); }));
+                          });
+
+            //The same through argv, where nothing is tokenized or copied before the parser sees it
+            check_scaling("huge_tokens (argv)", 1 << 20, 4,
+                          [](std::size_t n) { return std::string(n, 'x'); },
+                          [](const std::string& token)
+                          {
+                              carp::Parser parser(carp::CmdArg("name").abbreviation("n").action(carp::ArgAction::StoreSingle).build());
+                              char* argv[] { const_cast<char*>("program_name"), const_cast<char*>("--name"), const_cast<char*>(token.data()) };
+                              parser.parse(3, argv);
+                          });
+        }
+
+        static void repeated_options()
+        {
+            check_scaling("repeated_options (count)", 1 << 18, 32,
+                          [](std::size_t n) { return repeat("-v ", n); },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(carp::CmdArg("verbose").abbreviation("v").action(carp::ArgAction::Count).build());
+                              parser.parse(line);
+                              assert(parser.occurrences().size() == line.size() / 3);
+                          });
+
+            check_scaling("repeated_options (store single)", 1 << 17, 32,
+                          [](std::size_t n) { return repeat("--level 3 ", n); },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(carp::CmdArg("level").action(carp::ArgAction::StoreSingle).build());
+                              parser.parse(line);
+                          });
+        }
+
+        //One-byte values, the most bookkeeping per byte of input: a string, a token and an occurrence for every two bytes
+        static void many_values()
+        {
+            check_scaling("many_values", 1 << 17, 96,
+                          [](std::size_t n) { return "--files " + repeat("a ", n); },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(carp::CmdArg("files").action(carp::ArgAction::StoreMany).build());
+                              parser.parse(line);
+                          });
+        }
+
+        //Names of the same length that share all but their last few letters, the worst case for every name lookup
+        static void colliding_names()
+        {
+            auto name = [](std::size_t i)
+            {
+                std::string name = "option-" + std::string(48, 'x') + '-';
+                for (int letter = 0; letter < 4; ++letter, i /= 26)
+                    name.push_back(static_cast<char>('a' + i % 26));
+
+                return name;
+            };
+
+            check_scaling("colliding_names", 1 << 11, 256,
+                          [&](std::size_t n)
+                          {
+                              std::string line;
+                              for (std::size_t i = 0; i < n; ++i)
+                                  line.append("--").append(name(i)).append(" 1 ");
+
+                              return line;
+                          },
+                          [&](const std::string& line)
+                          {
+                              std::size_t count = line.size() / (name(0).size() + 5);
+                              std::vector<std::string> names;
+                              std::vector<carp::CmdArgSpec> specs;
+                              names.reserve(count);
+
+                              for (std::size_t i = 0; i < count; ++i)
+                              {
+                                  names.push_back(name(i));
+                                  specs.push_back({names.back(), names.back(), "", "", false, carp::ArgAction::StoreSingle});
+                              }
+
+                              carp::Parser parser;
+                              parser.add_arguments(specs);
+                              parser.parse(line);
+                              assert(parser.freeze().size() == count + 1);     //and --help
+                          });
+        }
+
+        //Every unknown option is reported, each with suggestions from the schema
+        static void unknown_options()
+        {
+            check_scaling("unknown_options", 1 << 12, 64,
+                          [](std::size_t n) { return repeat("--verbsoe ", n); },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(
+                                  carp::CmdArg("verbose").abbreviation("v").action(carp::ArgAction::SetTrue).build(),
+                                  carp::CmdArg("version").action(carp::ArgAction::SetTrue).build()
+                              );
+
+                              assert(throws_exception([&]() { parser.parse(line); }));
+                          });
+        }
+
+        //"(a*)*b" against a run of 'a' takes exponential time in a backtracking matcher; the error quotes the value
+        static void pattern_values()
+        {
+            check_scaling("pattern_values", 1 << 20, 6,
+                          [](std::size_t n) { return "--key " + std::string(n, 'a') + 'c'; },
+                          [](const std::string& line)
+                          {
+                              carp::Parser parser(carp::CmdArg("key").action(carp::ArgAction::StoreSingle).pattern("(a*)*b").build());
+                              assert(throws_exception([&]() { parser.parse(line); }));
+                          });
+        }
+
+        static void driver()
+        {
+            huge_tokens();
+            repeated_options();
+            many_values();
+            colliding_names();
+            unknown_options();
+            pattern_values();
+            std::cout << '\n';
+        }
+    };
+}
+#endif
@@ -11,9 +11,125 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #define stringify(a) #a
 
+/*
+    Every allocation made through the global operator new is counted, so tests can assert on allocation counts.
+    The bytes currently allocated, and the most ever allocated at once, are tracked as well where the C library
+    can tell the size of a block (glibc's malloc_usable_size), so operator delete can subtract what operator new
+    added; elsewhere `tracks_live_bytes` is false and both stay at zero.
+*/
+namespace tests
+{
+#ifdef __GLIBC__
+    constexpr bool tracks_live_bytes = true;
+
+    std::size_t block_size(void* memory)
+    {
+        return malloc_usable_size(memory);
+    }
+#else
+    constexpr bool tracks_live_bytes = false;
+
+    std::size_t block_size(void*)
+    {
+        return 0;
+    }
+#endif
+
+    std::atomic<std::size_t> allocation_count {0};
+    std::atomic<std::size_t> allocated_bytes {0};
+    std::atomic<std::size_t> live_bytes {0};
+    std::atomic<std::size_t> peak_bytes {0};
+
+    //Starts a new peak from what is allocated right now
+    void reset_peak_bytes()
+    {
+        peak_bytes.store(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+namespace tests
+{
+    void count_allocation(void* memory, std::size_t size)
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+        std::size_t size_of_block = block_size(memory);
+        std::size_t live = live_bytes.fetch_add(size_of_block, std::memory_order_relaxed) + size_of_block;
+        std::size_t peak = peak_bytes.load(std::memory_order_relaxed);
+
+        while (live > peak and not peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+    }
+
+    void count_release(void* memory)
+    {
+        if (memory != nullptr)
+            live_bytes.fetch_sub(block_size(memory), std::memory_order_relaxed);
+    }
+}
+
+/*
+    Neither operator new nor operator delete is inlined, so GCC's -Wmismatched-new-delete sees the two paired
+    with each other rather than with the std::malloc and std::free inside them.
+*/
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+    {
+        tests::count_allocation(memory, size);
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+//Over-aligned types, e.g. the cache-line aligned arguments of `FrozenArgs`
+[[gnu::noinline]] void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (size + align - 1) / align * align))
+    {
+        tests::count_allocation(memory, size);
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+//Every operator delete frees what its own operator new allocated: std::malloc and std::aligned_alloc both pair with std::free
+[[gnu::noinline]] void operator delete(void* memory) noexcept
+{
+    tests::count_release(memory);
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept
+{
+    tests::count_release(memory);
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::align_val_t) noexcept
+{
+    tests::count_release(memory);
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    tests::count_release(memory);
+    std::free(memory);
+}
+
 template <typename T>
 bool are_equal_vectors(std::vector<T> v1, std::vector<T> v2)
 {
@@ -35,6 +151,75 @@ void test(const char* file, const char* function_name, const Function& func, Arg
     std::cout << "SUCCESS (" << elapsed_time << "ms)\n";
 }
 
+//The most a test may allocate through operator new, both in number of allocations and in bytes, over its whole run
+struct AllocationBudget
+{
+    std::size_t allocations;
+    std::size_t bytes;
+};
+
+//Like `test`, but fails if `func` allocates more than `budget` allows, so that allocation regressions fail the build
+template <typename Function, typename... Args>
+void test(const char* file, const char* function_name, AllocationBudget budget, const Function& func, Args&&... args)
+{
+    using fpms = std::chrono::duration<double, std::milli>;
+    std::cout << std::fixed << std::setprecision(4);
+
+    std::cout << '[' << file << "] " << function_name << "...";
+    std::size_t allocations = tests::allocation_count.load();
+    std::size_t bytes = tests::allocated_bytes.load();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    func(std::forward<Args>(args)...);
+
+    double elapsed_time = std::chrono::duration_cast<fpms>(std::chrono::high_resolution_clock::now() - start).count();
+    allocations = tests::allocation_count.load() - allocations;
+    bytes = tests::allocated_bytes.load() - bytes;
+
+    if (allocations > budget.allocations or bytes > budget.bytes)
+    {
+        std::cout << "FAILED (" << allocations << " allocations of " << bytes << " bytes, over the budget of "
+                  << budget.allocations << " allocations of " << budget.bytes << " bytes)" << std::endl;
+        std::abort();
+    }
+
+    std::cout << "SUCCESS (" << elapsed_time << "ms, " << allocations << " allocations of " << bytes << " bytes)\n";
+}
+
+//Runs `func` `iterations` times and reports the throughput over `bytes` bytes of input per iteration
+template <typename Function>
+void benchmark(const char* file, const char* function_name, std::size_t bytes, std::size_t iterations, const Function& func)
+{
+    using fps = std::chrono::duration<double>;
+    std::cout << std::fixed << std::setprecision(4);
+
+    std::cout << '[' << file << "] " << function_name << "...";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (std::size_t i = 0; i < iterations; ++i)
+        func();
+
+    double elapsed_time = std::chrono::duration_cast<fps>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << (bytes * iterations) / elapsed_time / 1e9 << " GB/s (" << elapsed_time * 1000 / iterations << "ms per iteration)\n";
+}
+
+//Runs `func` `iterations` times and reports the average time per call
+template <typename Function>
+void benchmark(const char* file, const char* function_name, std::size_t iterations, const Function& func)
+{
+    using fpns = std::chrono::duration<double, std::nano>;
+    std::cout << std::fixed << std::setprecision(4);
+
+    std::cout << '[' << file << "] " << function_name << "...";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (std::size_t i = 0; i < iterations; ++i)
+        func();
+
+    double elapsed_time = std::chrono::duration_cast<fpns>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << elapsed_time / iterations << "ns per iteration\n";
+}
+
 template <typename Function, typename... Args>
 bool throws_exception(const Function& func, Args&&... args)
 {
@@ -0,0 +1,129 @@
+#pragma once
+
+#ifdef CARP_DEBUG
+
+#include <string>
+#include <vector>
+#include <string_view>
+#include <cassert>
+
+#include "test-utils.hh"
+#include "../src/tokenizer.hh"
+#include "../src/utf8.hh"
+
+namespace tests
+{
+    class TokenizerTests
+    {
+        public:
+        static void split_whitespace()
+        {
+            carp::Tokenizer tokenizer;
+            std::string_view line = "  --foo\tbar \n -b\r\n";
+
+            const std::vector<std::string_view>& tokens = tokenizer.split(line);
+            assert(are_equal_vectors(tokens, {"--foo", "bar", "-b"}));
+
+            //Plain tokens are views into the line itself
+            assert(tokens[0].data() == line.data() + 2);
+        }
+
+        static void split_quotes()
+        {
+            carp::Tokenizer tokenizer;
+
+            assert(are_equal_vectors(tokenizer.split(R"(--name 'John Smith' "two  spaces" '' "")"),
+                                     {"--name", "John Smith", "two  spaces", "", ""}));
+            assert(are_equal_vectors(tokenizer.split(R"(pre'fix'ed "a"'b'c 'it"s' "it's")"),
+                                     {"prefixed", "abc", "it\"s", "it's"}));
+        }
+
+        static void split_escapes()
+        {
+            carp::Tokenizer tokenizer;
+
+            assert(are_equal_vectors(tokenizer.split(R"(a\ b \'quoted\' back\\slash)"), {"a b", "'quoted'", "back\\slash"}));
+            assert(are_equal_vectors(tokenizer.split(R"("\"\\\$\`" "\n\x" '\n')"), {"\"\\$`", "\\n\\x", "\\n"}));
+            assert(are_equal_vectors(tokenizer.split("line\\\ncontinued"), {"linecontinued"}));
+        }
+
+        static void split_long_tokens()
+        {
+            //Long enough that the SIMD scan, not the scalar tail, finds the separators
+            carp::Tokenizer tokenizer;
+            std::string word(100, 'x');
+            std::string line = word + "\t" + word + "\\ " + word + " \"" + word + "\\\"" + word + "\"";
+
+            assert(are_equal_vectors(tokenizer.split(line), {word, word + " " + word, word + "\"" + word}));
+        }
+
+        static void split_errors()
+        {
+            carp::Tokenizer tokenizer;
+
+            assert(throws_exception([&]() { tokenizer.split("--name 'unterminated"); }));
+            assert(throws_exception([&]() { tokenizer.split("--name \"unterminated\\\""); }));
+            assert(throws_exception([&]() { tokenizer.split("trailing\\"); }));
+        }
+
+        static void copy_tokenizer()
+        {
+            carp::Tokenizer tokenizer;
+            const std::vector<std::string_view>& tokens = tokenizer.split("--name 'John Smith'");
+
+            //A copy has an arena of its own, so splitting with it leaves the original's tokens intact
+            carp::Tokenizer copy = tokenizer;
+            assert(are_equal_vectors(copy.split("'Jane Doe' x"), {"Jane Doe", "x"}));
+            assert(are_equal_vectors(tokens, {"--name", "John Smith"}));
+
+            copy = tokenizer;
+            assert(are_equal_vectors(copy.split("a\\ b"), {"a b"}));
+            assert(are_equal_vectors(tokens, {"--name", "John Smith"}));
+        }
+
+        static void utf8_validation()
+        {
+            using carp::detail::find_invalid_utf8;
+
+            assert(find_invalid_utf8("") == 0);
+            assert(find_invalid_utf8("plain ascii") == 11);
+            assert(find_invalid_utf8("gr\xC3\xB6\xC3\x9F" "e \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF") == 21);
+
+            //Stray continuation bytes, truncated sequences, overlongs, surrogates, and code points above U+10FFFF
+            assert(find_invalid_utf8("ab\x80") == 2);
+            assert(find_invalid_utf8("ab\xC3") == 2);
+            assert(find_invalid_utf8("ab\xE2\x82") == 2);
+            assert(find_invalid_utf8("ab\xC3(") == 2);
+            assert(find_invalid_utf8("\xC0\xAF") == 0);
+            assert(find_invalid_utf8("\xE0\x80\xAF") == 0);
+            assert(find_invalid_utf8("\xF0\x80\x80\xAF") == 0);
+            assert(find_invalid_utf8("\xED\xA0\x80") == 0);
+            assert(find_invalid_utf8("\xF4\x90\x80\x80") == 0);
+            assert(find_invalid_utf8("\xF5\x80\x80\x80") == 0);
+            assert(find_invalid_utf8("\xFF") == 0);
+
+            //Every position relative to the 16-byte blocks of the fast path, including sequences that straddle two blocks
+            for (std::size_t prefix = 0; prefix < 40; ++prefix)
+            {
+                std::string text = std::string(prefix, 'a') + "\xE2\x82\xAC" + std::string(20, 'b');
+                assert(find_invalid_utf8(text) == text.size());
+
+                text[prefix + 2] = 'c';
+                assert(find_invalid_utf8(text) == prefix);
+            }
+        }
+
+        static void driver()
+        {
+            test(__FILE__, stringify(split_whitespace), split_whitespace);
+            test(__FILE__, stringify(split_quotes), split_quotes);
+            test(__FILE__, stringify(split_escapes), split_escapes);
+            test(__FILE__, stringify(split_long_tokens), split_long_tokens);
+            test(__FILE__, stringify(split_errors), split_errors);
+            test(__FILE__, stringify(copy_tokenizer), copy_tokenizer);
+            test(__FILE__, stringify(utf8_validation), utf8_validation);
+            std::cout << '\n';
+        }
+    };
+}
+#endif